@@ -35,21 +35,42 @@ function getDialInfo(protocol, host, port) {
     return ziti.get_ziti_service(protocol, host, port);
 }
 
-function doConnect(options, callback) {
-    let dialInfo;
-    try {
-        dialInfo = getDialInfo('tcp', options.host, options.port);
-    } catch (e) {
+// Forwarding dial info for addresses no service intercepts, built once per host:port
+const FALLBACK_CACHE_SIZE = 1024;
+const fallbackDialInfo = new Map();
+
+function getFallbackDialInfo(host, port) {
+    const key = `${host}:${port}`;
+    let dialInfo = fallbackDialInfo.get(key);
+    if (dialInfo === undefined) {
         // construct forwarding data just in case hosting side needs it
         const data = {
             dst_protocol: "tcp",
-            dst_hostname: options.host,
-            dst_port: options.port.toString(),
+            dst_hostname: host,
+            dst_port: port.toString(),
         }
-        dialInfo = {
-            service: options.host,
+        dialInfo = Object.freeze({
+            service: host,
             dial_data: JSON.stringify(data),
+        });
+        if (fallbackDialInfo.size >= FALLBACK_CACHE_SIZE) {
+            fallbackDialInfo.delete(fallbackDialInfo.keys().next().value);
         }
+        fallbackDialInfo.set(key, dialInfo);
+    }
+    return dialInfo;
+}
+
+function doConnect(options, callback) {
+    let dialInfo;
+    try {
+        // cached natively, including addresses that no service intercepts (undefined)
+        dialInfo = getDialInfo('tcp', options.host, options.port);
+    } catch (e) {
+        dialInfo = undefined;
+    }
+    if (dialInfo === undefined) {
+        dialInfo = getFallbackDialInfo(options.host, options.port);
     }
 
     connect(dialInfo, callback)
@@ -95,4 +116,5 @@ function mkAgent(url) {
 }
 
 exports.connect = connect;
-exports.httpAgent = mkAgent;
\ No newline at end of file
+exports.httpAgent = mkAgent;
+exports.getFallbackDialInfo = getFallbackDialInfo;
\ No newline at end of file
@@ -40,8 +40,9 @@ limitations under the License.
  * @param {*} isWebSocket 
  * @param {*} on_connect_cb callback 
  * @param {*} on_data_cb callback 
+ * @param {*} options - { dataMode: 'concat' | 'array' }, how chunks arriving together are passed to on_data_cb
  */
-const dial = ( serviceName, isWebSocket, on_connect_cb, on_data_cb ) => {
+const dial = ( serviceName, isWebSocket, on_connect_cb, on_data_cb, options ) => {
 
   let connect_cb;
   let data_cb;
@@ -58,7 +59,9 @@ const dial = ( serviceName, isWebSocket, on_connect_cb, on_data_cb ) => {
     data_cb = on_data_cb;
   }
 
-  ziti.ziti_dial(serviceName, isWebSocket, connect_cb, data_cb);
+  let dataMode = (options && options.dataMode) || 'concat';
+
+  ziti.ziti_dial(serviceName, isWebSocket, connect_cb, data_cb, dataMode);
 
 };
 
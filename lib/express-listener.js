@@ -61,10 +61,13 @@ Server.prototype.on_listen = ( status ) => {
   
     let self = _servers.get(obj.js_arb_data);
 
-    const socket = new ZitiSocket({ client: obj.client });
+    const socket = new ZitiSocket({ client: obj.client, highWaterMark: self.highWaterMark });
+
+    self._sockets.set(obj.client, socket);
+    socket.once('close', () => {
+        self._sockets.delete(obj.client);
+    });
 
-    self._socket = socket;
-        
     self.emit('connection', socket);
 };
 
@@ -76,9 +79,11 @@ Server.prototype.on_listen = ( status ) => {
  Server.prototype.on_listen_client_data = ( obj ) => {
     
     let self    = _servers.get(obj.js_arb_data);
-    let socket  = self._socket;
+    let socket  = self._sockets.get(obj.client);
 
-    socket.captureData(obj.app_data);
+    if (typeof socket !== 'undefined') {
+        socket.captureData(obj.app_data, obj.closed);
+    }
 };
   
 
@@ -151,6 +156,8 @@ function Server(serviceName, options, connectionListener) {
     this._serviceName = serviceName;
 
     this._connections = 0;
+    this._sockets = new Map();    // client connection handle -> ZitiSocket
+    this.highWaterMark = options.highWaterMark;
   
     // this[async_id_symbol] = -1;
     this._handle = null;
@@ -46,7 +46,61 @@ const on_resp_data = ( obj ) => {
 
 };
 
-const httpRequest = ( serviceName, schemeHostPort, method, path, headers, on_req_cb, on_resp_cb, on_resp_data_cb ) => {   
+/**
+ * Build the headers object from the flat [ name, value, ... ] rawHeaders array delivered natively.
+ * Last value wins per name, except set-cookie values, which are collected into a 'Set-Cookie' array.
+ */
+const buildHeaders = ( rawHeaders ) => {
+    let headers = {};
+    let cookies;
+    for (let i = 0; i + 1 < rawHeaders.length; i += 2) {
+        let name = rawHeaders[i];
+        if (name.toLowerCase() === 'set-cookie') {
+            if (typeof cookies === 'undefined') {
+                cookies = [];
+            }
+            cookies.push(rawHeaders[i + 1]);
+        } else {
+            headers[name] = rawHeaders[i + 1];
+        }
+    }
+    if (typeof cookies !== 'undefined') {
+        headers['Set-Cookie'] = cookies;
+    }
+    return headers;
+};
+
+/**
+ * Give the response object a lazy 'headers' property, built from rawHeaders on first access
+ */
+const withLazyHeaders = ( cb ) => {
+    return ( obj ) => {
+        if (obj && Array.isArray(obj.rawHeaders)) {
+            Object.defineProperty(obj, 'headers', {
+                configurable: true,
+                enumerable: true,
+                get() {
+                    let headers = buildHeaders(obj.rawHeaders);
+                    Object.defineProperty(obj, 'headers', { value: headers, writable: true, enumerable: true, configurable: true });
+                    return headers;
+                },
+            });
+        }
+        return cb( obj );
+    };
+};
+
+/**
+ * httpRequest()
+ *
+ * @param {*} options - {
+ *                        pool: { minIdle, maxClients, idleTimeoutMs },  client pool settings for this scheme/host/port
+ *                        connectTimeoutMs, ttfbTimeoutMs, timeoutMs,    deadlines (ms) for getting a client, the response headers, and the whole response
+ *                        signal                                         an AbortSignal that cancels the request
+ *                        highWaterMark                                  body bytes that may be waiting to be written before httpRequestData returns false
+ *                      }
+ */
+const httpRequest = ( serviceName, schemeHostPort, method, path, headers, on_req_cb, on_resp_cb, on_resp_data_cb, options ) => {   
 
     let _on_req_cb;
     let _on_resp_cb;
@@ -63,6 +117,7 @@ const httpRequest = ( serviceName, schemeHostPort, method, path, headers, on_req
     } else {
         _on_resp_cb = on_resp_cb;
     }
+    _on_resp_cb = withLazyHeaders( _on_resp_cb );
 
     if (typeof on_resp_data_cb === 'undefined') {
         _on_resp_data_cb = on_resp_data;
@@ -72,7 +127,31 @@ const httpRequest = ( serviceName, schemeHostPort, method, path, headers, on_req
 
     return new Promise((resolve, reject) => {
         try {
-            let req = ziti.Ziti_http_request( serviceName, schemeHostPort, method, path, headers, _on_req_cb, _on_resp_cb, _on_resp_data_cb );
+            let pool = (options && options.pool) || undefined;
+            let reqOptions = undefined;
+            if (options && (options.connectTimeoutMs || options.ttfbTimeoutMs || options.timeoutMs || options.highWaterMark)) {
+                reqOptions = {
+                    connectTimeoutMs: options.connectTimeoutMs,
+                    ttfbTimeoutMs:    options.ttfbTimeoutMs,
+                    timeoutMs:        options.timeoutMs,
+                    highWaterMark:    options.highWaterMark,
+                };
+            }
+            let signal = options && options.signal;
+
+            if (signal && signal.aborted) {
+                throw (signal.reason || new Error('The operation was aborted'));
+            }
+
+            let req = ziti.Ziti_http_request( serviceName, schemeHostPort, method, path, headers, _on_req_cb, _on_resp_cb, _on_resp_data_cb, pool, reqOptions );
+
+            if (signal) {
+                // Cancelling a request that has already completed does nothing
+                signal.addEventListener('abort', () => {
+                    ziti.Ziti_http_request_cancel( req );
+                }, { once: true });
+            }
+
             return resolve( req );
         } catch (e) {
           reject(e);
@@ -82,4 +161,5 @@ const httpRequest = ( serviceName, schemeHostPort, method, path, headers, on_req
 
 
 exports.httpRequest = httpRequest;
+exports.buildHeaders = buildHeaders;
 
@@ -21,14 +21,16 @@ limitations under the License.
  */
 const on_req_data = ( obj ) => {
 
-    console.log('on_req_data entered: ', obj);
-    console.log('as string: ', obj.body.toString('utf8'));
-
 };
 
-const httpRequestData = ( req, buffer, on_req_data_cb ) => {
-
-    console.log('httpRequestData entered: ', req, buffer);
+/**
+ * httpRequestData()
+ *
+ * The Buffer is not copied; leave it untouched until on_req_data_cb fires for it.
+ * Returns false once the body bytes still waiting to be written reach the request's highWaterMark;
+ * on_drain_cb is then called when they have all been written.
+ */
+const httpRequestData = ( req, buffer, on_req_data_cb, on_drain_cb ) => {
 
     let _on_req_data_cb;
 
@@ -38,7 +40,7 @@ const httpRequestData = ( req, buffer, on_req_data_cb ) => {
         _on_req_data_cb = on_req_data_cb;
     }
 
-    ziti.Ziti_http_request_data( req, buffer, _on_req_data_cb );
+    return ziti.Ziti_http_request_data( req, buffer, _on_req_data_cb, on_drain_cb );
 };
 
 
@@ -24,9 +24,20 @@ limitations under the License.
  *   - action: 'login_external', 'select_external', 'cannot_continue', 'prompt_totp', 'prompt_pin'
  *   - type: The authentication type (e.g., 'oidc')
  *   - detail: Additional details (e.g., the OIDC provider URL)
+ * @param {object} [options] - Optional settings.
+ * @param {boolean} [options.networkThread] - Run the Ziti context (TLS, framing, crypto) on a dedicated
+ *   native thread instead of Node's main loop. The thread then stays, and later inits run on it as well.
+ * @param {string} [options.serviceCache] - File to keep the last known services (and their intercept configs) in.
+ *   When it holds any, the returned promise resolves right away, before the controller has been reached, and
+ *   lookups are answered from the cached services until the controller's first service event reconciles them
+ *   (see `servicesProvisional`). Controller and authentication failures after that point do not reject the
+ *   promise; `contextStatus` reports them.
  * @returns {Promise<void>} Resolves when initialization is complete.
  */
-const init = ( identityPath, onAuthEvent ) => {
+const init = ( identityPath, onAuthEvent, options ) => {
+
+  const networkThread = (options && options.networkThread) === true;
+  const serviceCache = (options && typeof options.serviceCache === 'string') ? options.serviceCache : undefined;
 
   return new Promise((resolve, reject) => {
       try {
@@ -35,7 +46,7 @@ const init = ( identityPath, onAuthEvent ) => {
                   return reject(result);
               }
               return resolve( result );
-          }, onAuthEvent);
+          }, onAuthEvent, networkThread, serviceCache);
       } catch (e) {
           reject(e);
       }
@@ -46,5 +57,15 @@ const shutdown = () => {
     ziti.ziti_shutdown();
 }
 
+/**
+ * contextStatus()
+ *
+ * @returns { status, error } - the context's latest controller/authentication status: 0, or a failure and its description
+ */
+const contextStatus = () => {
+    return ziti.ziti_context_status();
+}
+
 exports.init = init;
 exports.shutdown = shutdown;
+exports.contextStatus = contextStatus;
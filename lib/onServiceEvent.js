@@ -0,0 +1,105 @@
+/*
+Copyright NetFoundry Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+const listeners = new Set();
+
+// The services the identity has, by name, as of the last event fanned out; kept while anyone listens
+const services = new Map();
+
+/**
+ * Replace each service's raw config JSON with the parsed config
+ */
+const parseConfigs = ( services ) => {
+    for (const service of services) {
+        for (const [type, json] of Object.entries(service.configs)) {
+            try {
+                service.configs[type] = JSON.parse(json);
+            } catch (e) {
+                // leave a config that isn't valid JSON as the raw string
+            }
+        }
+    }
+};
+
+/**
+ * on_service_event()
+ *
+ * Receives one native service event's diff and fans it out to every listener.
+ */
+const on_service_event = ( event ) => {
+
+    // an event already on its way when the last listener left
+    if (listeners.size === 0) {
+        return;
+    }
+
+    parseConfigs(event.added);
+    parseConfigs(event.changed);
+    parseConfigs(event.removed);
+
+    for (const service of event.removed) {
+        services.delete(service.name);
+    }
+    for (const service of event.added.concat(event.changed)) {
+        services.set(service.name, service);
+    }
+
+    for (const cb of Array.from(listeners)) {
+        cb( event );
+    }
+};
+
+/**
+ * onServiceEvent()
+ *
+ * The first event a listener sees adds every service the identity already has; it is delivered before
+ * onServiceEvent returns, ahead of any later event.
+ *
+ * @param {*} cb  called with { added, changed, removed } for each service event
+ * @returns {Function} call it to stop listening
+ */
+const onServiceEvent = ( cb ) => {
+
+    if (typeof cb !== 'function') {
+        throw new TypeError('onServiceEvent requires a callback function');
+    }
+
+    if (listeners.size === 0) {
+        // native hands the current services to on_service_event before it returns, so listen first
+        listeners.add( cb );
+        try {
+            ziti.ziti_set_service_event_callback( on_service_event );
+        } catch (e) {
+            listeners.delete( cb );
+            throw e;
+        }
+    } else {
+        listeners.add( cb );
+        if (services.size > 0) {
+            // the same, for a listener joining the ones native already delivers to
+            cb( { added: Array.from(services.values()), changed: [], removed: [] } );
+        }
+    }
+
+    return () => {
+        if (listeners.delete( cb ) && (listeners.size === 0)) {
+            ziti.ziti_set_service_event_callback( undefined );
+            services.clear();
+        }
+    };
+};
+
+exports.onServiceEvent = onServiceEvent;
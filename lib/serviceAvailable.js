@@ -44,4 +44,45 @@ const serviceAvailable = ( service, sa_cb ) => {
 
 };
 
+/**
+ * serviceAvailableSync()
+ *
+ * Answered from the addon's table of services, as of the last service refresh.
+ *
+ * @param {*} service
+ * @returns the permissions (1 dial, 2 bind), or <0 if the identity has no such service
+ */
+const serviceAvailableSync = ( service ) => {
+
+  return ziti.ziti_service_available_sync( service );
+
+};
+
+/**
+ * servicesAvailableSync()
+ *
+ * @param {*} services  array of service names
+ * @returns Int32Array holding, for each name, what serviceAvailableSync would return
+ */
+const servicesAvailableSync = ( services ) => {
+
+  return ziti.ziti_services_available_sync( services );
+
+};
+
+/**
+ * servicesProvisional()
+ *
+ * @returns true while the services were restored from the service cache (see init's serviceCache
+ *   option) and the controller has not yet confirmed them
+ */
+const servicesProvisional = () => {
+
+  return ziti.ziti_services_provisional();
+
+};
+
 exports.serviceAvailable = serviceAvailable;
+exports.serviceAvailableSync = serviceAvailableSync;
+exports.servicesAvailableSync = servicesAvailableSync;
+exports.servicesProvisional = servicesProvisional;
@@ -0,0 +1,30 @@
+/*
+Copyright NetFoundry Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * setHighWaterMark()   
+ * 
+ * @param {*} conn 
+ * @param {*} highWaterMark - max inbound bytes queued for JS before the sender is throttled
+ */
+const setHighWaterMark = ( conn, highWaterMark ) => {
+
+  ziti.ziti_set_high_water_mark( conn, highWaterMark );
+
+};
+
+exports.setHighWaterMark = setHighWaterMark;
@@ -0,0 +1,29 @@
+/*
+Copyright NetFoundry Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * setHttpPoolConfig()   
+ * 
+ * @param {*} config - { minIdle, maxClients, idleTimeoutMs }
+ */
+const setHttpPoolConfig = ( config ) => {
+
+  ziti.ziti_set_https_pool_config( config );
+
+};
+
+exports.setHttpPoolConfig = setHttpPoolConfig;
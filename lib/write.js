@@ -30,8 +30,9 @@ const on_write = ( status ) => {
  * @param {*} conn 
  * @param {*} buf 
  * @param {*} on_write callback 
+ * @param {*} copy - if true, buf is copied rather than pinned until on_write fires
  */
-const write = ( conn, buf, on_write_cb ) => {
+const write = ( conn, buf, on_write_cb, copy ) => {
 
   let cb;
 
@@ -41,7 +42,7 @@ const write = ( conn, buf, on_write_cb ) => {
     cb = on_write_cb;
   }
 
-  ziti.ziti_write( conn, buf, cb );
+  ziti.ziti_write( conn, buf, cb, copy === true );
 
 };
 
@@ -0,0 +1,48 @@
+/*
+Copyright NetFoundry Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * on_write()   
+ * 
+ */
+const on_write = ( status ) => {
+
+};
+
+
+/**
+ * writev()   
+ * 
+ * @param {*} conn 
+ * @param {*} bufs - Array of Buffers, written as one logical write
+ * @param {*} on_write callback, invoked once all of bufs has been written
+ */
+const writev = ( conn, bufs, on_write_cb ) => {
+
+  let cb;
+
+  if (typeof on_write_cb === 'undefined') {
+    cb = on_write;
+  } else {
+    cb = on_write_cb;
+  }
+
+  ziti.ziti_writev( conn, bufs, cb );
+
+};
+
+exports.writev = writev;
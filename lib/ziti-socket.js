@@ -14,106 +14,265 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
-const EventEmitter = require('events');
 const stream = require('stream');
 const zitiWrite = require('./write').write;
+const zitiWritev = require('./writev').writev;
+const zitiClose = require('./close').close;
+const zitiCloseWrite = require('./closeWrite').closeWrite;
+const zitiPause = require('./pause').pause;
+const zitiResume = require('./resume').resume;
+const zitiSetHighWaterMark = require('./setHighWaterMark').setHighWaterMark;
+const zitiSetCoalesceDelay = require('./setCoalesceDelay').setCoalesceDelay;
 
 
+/**
+ * How long (microseconds) writes are held back to coalesce after setNoDelay(false)
+ */
+const NAGLE_COALESCE_DELAY_US = 1000;
 
-class ZitiSocket extends EventEmitter {
+
+function toBuffer(chunk, encoding) {
+    if (Buffer.isBuffer(chunk)) {
+        return chunk;
+    } else if (typeof chunk === 'string' || chunk instanceof String) {
+        return Buffer.from(chunk, encoding || 'utf8');
+    } else if (chunk instanceof Uint8Array) {
+        return Buffer.from(chunk.buffer, chunk.byteOffset, chunk.byteLength);
+    }
+    throw new Error('chunk type of [' + typeof chunk + '] is not a supported type');
+}
+
+function writeError(status) {
+    const err = new Error('ziti write failed: ' + status);
+    err.code = 'EZITIWRITE';
+    err.status = status;
+    return err;
+}
+
+
+/**
+ * A stream.Duplex over a client connection accepted by ziti.listen, suitable for handing to http.Server.
+ *
+ * Writes complete when the native on_write fires, so the writable side applies real backpressure.
+ * Inbound data is pushed as it arrives; once the readable buffer is full the native connection is
+ * paused (leaving the data unacknowledged, which throttles the sender) until _read asks for more.
+ * A readable highWaterMark given by the caller is also used as the connection's native high water mark.
+ * Ending the writable side half-closes the connection; the peer's data is still read until it closes.
+ */
+class ZitiSocket extends stream.Duplex {
 
     constructor(opts) {
 
-        super();
+        opts = opts || {};
 
-        if (typeof opts !== 'undefined') {
-            if (typeof opts.client !== 'undefined') {
-                this.client = opts.client;
-            }
+        super({
+            highWaterMark: opts.highWaterMark,
+            readableHighWaterMark: opts.readableHighWaterMark,
+            writableHighWaterMark: opts.writableHighWaterMark,
+            allowHalfOpen: opts.allowHalfOpen || false,
+            decodeStrings: true,
+        });
+
+        if (typeof opts.client !== 'undefined') {
+            this.client = opts.client;
         }
 
-        this._writableState = new stream.Writable.WritableState({}, this, true);
-         
-        /**
-         * This stream is where we'll put any data returned from Ziti (see on_listen_client_data cb)
-         */
-        let self = this;
-        this.readableZitiStream = new ReadableStream({
-            start(controller) {
-                self.readableZitiStreamController = controller;
-            }
-        });
+        this.remoteAddress = opts.remoteAddress;
+        this.connecting = false;
+        this._nativePaused = false;
+        this._nativeClosed = false;
+        this._timeoutMs = 0;
+        this._timer = null;
+
+        const hwm = (typeof opts.readableHighWaterMark !== 'undefined') ? opts.readableHighWaterMark : opts.highWaterMark;
+        if ((typeof this.client !== 'undefined') && (typeof hwm === 'number') && (hwm > 0)) {
+            zitiSetHighWaterMark(this.client, this.readableHighWaterMark);
+        }
     }
 
 
     /**
-     * 
+     * Called with each on_listen_client_data item for this client. No data means the peer is done sending;
+     * 'closed' means native has already closed the connection (on error).
      */
-    captureData(data) {
+    captureData(data, closed) {
+
+        if (closed) {
+            this._nativeClosed = true;
+        }
 
         if ((typeof data !== 'undefined') && (data.byteLength > 0)) {
 
-            this.readableZitiStreamController.enqueue(data);
-            this.emit('data', data);
+            this._refreshTimeout();
+
+            if (!this.push(data) && !this._nativePaused) {
+                this._nativePaused = true;
+                zitiPause(this.client);
+            }
+
+        } else if (closed) {
+
+            this.destroy();
 
         } else {
 
-            this.emit('close');
+            this.push(null);
 
         }
     }
-     
+
+
+    /**
+     * Implements the readable stream method `_read`: the reader wants more, so let native deliver again
+     */
+    _read(size) {
+        if (this._nativePaused && !this._nativeClosed) {
+            this._nativePaused = false;
+            zitiResume(this.client);
+        }
+    }
+
 
     /**
      * Implements the writeable stream method `_write` by pushing the data onto the underlying Ziti connection.
-    */
-    async write(chunk, encoding, cb) {
+     * The write completes when native reports it written.
+     */
+    _write(chunk, encoding, cb) {
 
         let buffer;
+        try {
+            buffer = toBuffer(chunk, encoding);
+        } catch (err) {
+            return cb(err);
+        }
 
-        if (typeof chunk === 'string' || chunk instanceof String) {
-            buffer = Buffer.from(chunk, 'utf8');
-        } else if (Buffer.isBuffer(chunk)) {
-            buffer = chunk;
-        } else if (chunk instanceof Uint8Array) {
-            buffer = Buffer.from(chunk, 'utf8');
-        } else {
-            throw new Error('chunk type of [' + typeof chunk + '] is not a supported type');
+        if (buffer.length === 0) {
+            return cb();
         }
 
-        if (buffer.length > 0) {
-            zitiWrite(this.client, buffer);
+        this._refreshTimeout();
+
+        try {
+            zitiWrite(this.client, buffer, (obj) => {
+                cb((obj.status < 0) ? writeError(obj.status) : null);
+            });
+        } catch (err) {
+            cb(err);
+        }
+    }
+
+
+    /**
+     * Implements the writeable stream method `_writev`; corked or queued chunks go out as one native writev
+     */
+    _writev(chunks, cb) {
+
+        let bufs;
+        try {
+            bufs = chunks.map((c) => toBuffer(c.chunk, c.encoding));
+        } catch (err) {
+            return cb(err);
         }
-        if (cb) {
-            cb();
+
+        this._refreshTimeout();
+
+        try {
+            zitiWritev(this.client, bufs, (obj) => {
+                cb((obj.status < 0) ? writeError(obj.status) : null);
+            });
+        } catch (err) {
+            cb(err);
         }
     }
 
+
     /**
-     *
+     * Implements the writeable stream method `_final`: send what is queued, then half-close the connection
      */
-    _read() { /* NOP */ }
-    read()  { /* NOP */ }
-    destroy() { /* NOP */ } 
-    cork() { /* NOP */ }
-    uncork() { /* NOP */ }
-    pause() { /* NOP */ }
-    resume() { /* NOP */ }
-    destroy() { /* NOP */ }
-    end(data, encoding, callback) { /* NOP */ }
-    _final(cb) { cb(); }
-    setTimeout() { /* NOP */ }
-    setNoDelay() { /* NOP */ }
-    unshift(head) { /* NOP */ }
-}
+    _final(cb) {
+
+        if (!this._nativeClosed && (typeof this.client !== 'undefined')) {
+            try {
+                zitiCloseWrite(this.client);
+            } catch (err) {
+                return cb(err);
+            }
+        }
+
+        cb();
+    }
+
+
+    _destroy(err, cb) {
+
+        this._clearTimeout();
 
-Object.defineProperty(ZitiSocket.prototype, 'writable', {
-    get() {
-      return (
-        true
-      );
+        if (!this._nativeClosed && (typeof this.client !== 'undefined')) {
+            this._nativeClosed = true;
+            try {
+                zitiClose(this.client);
+            } catch (e) {
+                /* already closed */
+            }
+        }
+
+        cb(err);
     }
-});
+
+
+    /**
+     * Same contract as net.Socket#setTimeout: emit 'timeout' after 'msecs' without activity
+     */
+    setTimeout(msecs, callback) {
+
+        this._timeoutMs = msecs;
+        this._clearTimeout();
+
+        if (typeof callback === 'function') {
+            if (msecs === 0) {
+                this.removeListener('timeout', callback);
+            } else {
+                this.once('timeout', callback);
+            }
+        }
+
+        if (msecs > 0) {
+            this._timer = setTimeout(() => this.emit('timeout'), msecs);
+            this._timer.unref();
+        }
+
+        return this;
+    }
+
+    _refreshTimeout() {
+        if (this._timer !== null) {
+            this._timer.refresh();
+        }
+    }
+
+    _clearTimeout() {
+        if (this._timer !== null) {
+            clearTimeout(this._timer);
+            this._timer = null;
+        }
+    }
+
+
+    /**
+     * setNoDelay(false) lets small writes coalesce natively, Nagle-style
+     */
+    setNoDelay(noDelay) {
+        if (!this._nativeClosed && (typeof this.client !== 'undefined')) {
+            zitiSetCoalesceDelay(this.client, (noDelay === false) ? NAGLE_COALESCE_DELAY_US : 0);
+        }
+        return this;
+    }
+
+    setKeepAlive() { return this; }
+    ref() { return this; }
+    unref() { return this; }
+    address() { return {}; }
+}
 
 
 exports.ZitiSocket = ZitiSocket;
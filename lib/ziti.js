@@ -49,6 +49,15 @@ ziti = module.exports = exports = binding;
  */
 exports.close             = require('./close').close;
 
+/**
+ * Half-close a Ziti connection: send whatever is queued, then signal the peer that no more data follows.
+ * Data from the peer is still delivered until it closes its side.
+ * @function closeWrite
+ * @param {number} conn - A Ziti connection handle.
+ * @returns {void} No return value.
+ */
+exports.closeWrite        = require('./closeWrite').closeWrite;
+
 /**
  * Create a connection to Ziti Service.
  * @async
@@ -57,6 +66,9 @@ exports.close             = require('./close').close;
  * @param {boolean} isWebSocket - True or False indicator concerning whether this connection if bi-directional.
  * @param {onConnectCallback} onConnect - The callback that receives the connection handle.
  * @param {onDataCallback} onData - The callback that receives incoming data from the connection.
+ * @param {object} [options] - Connection options.
+ * @param {string} [options.dataMode] - 'concat' (default) passes all data that arrived since the previous
+ * onData call as one Buffer; 'array' passes it as an Array of Buffers, one per chunk received.
  * @returns {void} No return value.
  */
 /**
@@ -67,7 +79,7 @@ exports.close             = require('./close').close;
 /**
  * This callback is part of the `dial` API.
  * @callback onConnectCallback - The callback that receives incoming data from the connection.
- * @param {Buffer} data - Incoming data from the Ziti connection.
+ * @param {Buffer|Buffer[]} data - Incoming data from the Ziti connection (an Array in 'array' dataMode).
  * @returns {void} No return value.
  */
 exports.dial              = require('./dial').dial;
@@ -107,12 +119,21 @@ exports.express           = require('./express').express;
  * @param {onRequestCallback} onRequest - The callback that receives the request handle.
  * @param {onResonseCallback} onResponse - The callback that receives the HTTP Response.
  * @param {onResonseDataCallback} onResponseData - The callback that receives the HTTP Response data.
- * @returns {void} No return value.
+ * @param {object} [options] - Request options.
+ * @param {object} [options.pool] - Client pool settings for this scheme/host/port (see `setHttpPoolConfig`); they persist for later requests.
+ * @param {number} [options.connectTimeoutMs] - Deadline for the request to get a pooled client.
+ * @param {number} [options.ttfbTimeoutMs] - Deadline for the response headers to arrive.
+ * @param {number} [options.timeoutMs] - Deadline for the whole response. When any deadline passes, the request is
+ * cancelled and onResponse receives code `UV_ETIMEDOUT` (or, once the headers are in, onResponseData receives it as `len`).
+ * @param {AbortSignal} [options.signal] - Aborting it cancels the request (see `httpRequestCancel`).
+ * @param {number} [options.highWaterMark=65536] - Body bytes that may be waiting to be written before `httpRequestData` returns false.
+ * @returns {Promise<object>} Resolves to the request handle. Payload data and the end may be sent on it right away;
+ * they are held until the request has a client. The handle stays valid for as long as it is referenced.
  */
 /**
  * This callback is part of the `httpRequest` API.
  * @callback onRequestCallback - The callback that receives the request handle.
- * @param {number} req - A Ziti HttpRequest handle.
+ * @param {object} req - A Ziti HttpRequest handle.
  * @returns {void} No return value.
  */
 /**
@@ -121,7 +142,8 @@ exports.express           = require('./express').express;
  * @param resp - Incoming response from the HTTP request.
  * @param resp.req - The request handle.
  * @param resp.code - The HTTP status code.
- * @param resp.headers - The HTTP Headers on the response.
+ * @param resp.rawHeaders - The HTTP Headers on the response as a flat [ name, value, name, value, ... ] array.
+ * @param resp.headers - The HTTP Headers on the response as an object, built from rawHeaders on first access.
  * @returns {void} No return value.
  */
 /**
@@ -138,10 +160,11 @@ exports.httpRequest       = require('./httpRequest').httpRequest;
 /**
  * Send payload data for HTTP POST request to a Ziti Service.
  * @function httpRequestData
- * @param {number} req - A Ziti HttpRequest handle.
- * @param {Buffer} data - The HTTP payload data to send.
+ * @param {object} req - A Ziti HttpRequest handle.
+ * @param {Buffer} data - The HTTP payload data to send. It is not copied, so leave it untouched until onRequestData fires.
  * @param {onRequestDataCallback} onRequestData - The callback that acknowleges the send.
- * @returns {void} No return value.
+ * @param {Function} [onDrain] - Called once all queued payload data has been written, after a call returned false.
+ * @returns {boolean} false when the queued payload data has reached the request's highWaterMark; wait for onDrain before sending more.
  */
 /**
  * This callback is part of the `httpRequestData` API.
@@ -153,10 +176,20 @@ exports.httpRequest       = require('./httpRequest').httpRequest;
 */
  exports.httpRequestData   = require('./httpRequestData').httpRequestData;
 
+/**
+ * Cancel an HTTP request that has not completed. Its pool slot is given up, and onResponse receives
+ * code `UV_ECANCELED` (or, once the headers are in, onResponseData receives it as `len`). Does nothing
+ * if the request has completed.
+ * @function httpRequestCancel
+ * @param {object} req - A Ziti HttpRequest handle.
+ * @returns {void} No return value.
+ */
+exports.httpRequestCancel = require('./httpRequestCancel').httpRequestCancel;
+
 /**
  * Terminate payload data transmission for HTTP POST request to a Ziti Service.
  * @function httpRequestEnd
- * @param {number} req - A Ziti HttpRequest handle.
+ * @param {object} req - A Ziti HttpRequest handle.
  * @returns {void} No return value.
  */
  exports.httpRequestEnd   = require('./httpRequestEnd').httpRequestEnd;
@@ -239,6 +272,14 @@ exports.extAuthToken      = require('./extAuthToken').extAuthToken;
  * @function init
  * @param {string} identityPath - File system path to the identity file.
  * @param {onAuthEventCallback} [onAuthEvent] - Optional callback for authentication events.
+ * @param {object} [options] - Optional settings.
+ * @param {boolean} [options.networkThread] - If true, the Ziti context runs on a dedicated native thread
+ * rather than Node's main loop. dial, listen, write, close and the flow-control calls are forwarded to it;
+ * httpRequest, websocketConnect, connect and extAuthToken are not available in this mode. Once started, the thread
+ * stays for the life of the process, and contexts from later inits run on it too.
+ * @param {string} [options.serviceCache] - File to keep the last known services in. When it holds any, init resolves
+ * without waiting for the controller, and the cached services serve lookups until the first refresh (see `servicesProvisional`);
+ * a later controller or authentication failure is then reported by `contextStatus`, not by the promise.
  * @returns {Promise<void>} Resolves when initialization is complete.
  */
 /**
@@ -252,6 +293,15 @@ exports.extAuthToken      = require('./extAuthToken').extAuthToken;
  */
 exports.init              = require('./init').init;
 
+/**
+ * The Ziti context's latest controller/authentication status. With the `serviceCache` option, init can resolve
+ * before the controller is reached, so a failure after that is only visible here.
+ * @function contextStatus
+ * @returns {object} `{ status, error }`: `status` is 0 while all is well (or not yet known), otherwise the
+ * Ziti error code, and `error` then describes it.
+ */
+exports.contextStatus     = require('./init').contextStatus;
+
 /**
  * Initialize external authentication with a Ziti controller.
  * @function initExternalAuth
@@ -264,6 +314,55 @@ exports.initExternalAuth  = require('./initExternalAuth').initExternalAuth;
 // Internal use only
 exports.listen            = require('./listen').listen;
 
+/**
+ * Stop delivering inbound data on a dialed or accepted connection. Data not yet
+ * delivered is left unacknowledged, so the sender is throttled.
+ * @function pause
+ * @param {number} conn - A Ziti connection handle.
+ * @returns {void} No return value.
+ */
+exports.pause             = require('./pause').pause;
+
+/**
+ * Resume delivering inbound data on a connection paused by `pause`. Data held back while paused is
+ * delivered first, without waiting for more to arrive.
+ * @function resume
+ * @param {number} conn - A Ziti connection handle.
+ * @returns {void} No return value.
+ */
+exports.resume            = require('./resume').resume;
+
+/**
+ * Set how many inbound bytes may be queued for delivery to JS on a connection
+ * before the sender is throttled (default 1 MiB).
+ * @function setHighWaterMark
+ * @param {number} conn - A Ziti connection handle.
+ * @param {number} highWaterMark - Limit, in bytes.
+ * @returns {void} No return value.
+ */
+exports.setHighWaterMark  = require('./setHighWaterMark').setHighWaterMark;
+
+/**
+ * Set the client pool settings for `httpRequest`, for every scheme/host/port. Clients are created
+ * on demand, up to `maxClients` per scheme/host/port; further requests wait for one to free up.
+ * Idle clients beyond `minIdle` are closed after `idleTimeoutMs`. Omitted settings are unchanged.
+ * @function setHttpPoolConfig
+ * @param {object} config - Pool settings.
+ * @param {number} [config.minIdle] - Idle clients kept open regardless of the timeout (default 0).
+ * @param {number} [config.maxClients] - Maximum clients per scheme/host/port (default 25).
+ * @param {number} [config.idleTimeoutMs] - How long a client may sit idle before it is closed; 0 means never (default 30000).
+ * @returns {void} No return value.
+ */
+exports.setHttpPoolConfig = require('./setHttpPoolConfig').setHttpPoolConfig;
+
+/**
+ * Current counts across the `httpRequest` client pools.
+ * @function httpPoolStats
+ * @returns {object} `{ pools, clients, idleClients, waitingRequests, drainingClients }`, where
+ * `drainingClients` are clients that were closed (after an error, or for being idle) and are not yet freed.
+ */
+exports.httpPoolStats     = require('./httpPoolStats').httpPoolStats;
+
 /**
  * Set the logging level.
  * @function setLogLevel
@@ -302,12 +401,54 @@ exports.setLogger         = logger.setLogger;
  */
 exports.serviceAvailable  = require('./serviceAvailable').serviceAvailable;
 
+/**
+ * Look up a service synchronously, from the services the addon learned at the last service refresh.
+ * @function serviceAvailableSync
+ * @param {string} serviceName - The name of the Ziti Service being queried.
+ * @returns {number} The permissions (1 means the identity can dial, 2 means it can bind), or <0 if the identity has no such service.
+ */
+exports.serviceAvailableSync  = require('./serviceAvailable').serviceAvailableSync;
+
+/**
+ * Batch form of `serviceAvailableSync`.
+ * @function servicesAvailableSync
+ * @param {string[]} serviceNames - The names of the Ziti Services being queried.
+ * @returns {Int32Array} For each name, what `serviceAvailableSync` would return.
+ */
+exports.servicesAvailableSync = require('./serviceAvailable').servicesAvailableSync;
+
+/**
+ * Whether the services are still the ones restored from the service cache (see the `serviceCache` option of `init`),
+ * not yet confirmed by the controller. Lookups then see only those services, and the address lookups behind `httpRequest` and the HTTP agents resolve to the service name alone.
+ * @function servicesProvisional
+ * @returns {boolean} True until the controller's first service event has reconciled the cached services.
+ */
+exports.servicesProvisional = require('./serviceAvailable').servicesProvisional;
+
+/**
+ * Listen for services being added, changed or removed, instead of polling `serviceAvailable`.
+ * @function onServiceEvent
+ * @param {onServiceEventCallback} onEvent - Called once per service event with everything that changed in it.
+ * @returns {Function} Call it to stop listening.
+ */
+/**
+ * This callback is part of the `onServiceEvent` API.
+ * @callback onServiceEventCallback - Receives one service event's diff. The first one adds every service the
+ * identity already has, and is delivered before `onServiceEvent` returns.
+ * @param event - `{ added, changed, removed }`, each an array of
+ * `{ name, id, permissions: { dial, bind }, configs: { 'intercept.v1', 'ziti-tunneler-client.v1', 'zrok.proxy.v1' } }`
+ * holding the parsed configs the service has.
+ * @returns {void} No return value.
+ */
+exports.onServiceEvent    = require('./onServiceEvent').onServiceEvent;
+
 /**
  * write data to a Ziti connection.
  * @function write
  * @param {number} conn - A Ziti connection handle.
- * @param {Buffer} data - The data to send.
+ * @param {Buffer} data - The data to send. The Buffer is not copied; it must not be modified until onWrite fires.
  * @param {onWriteCallback} onWrite - The callback that returns status of the write.
+ * @param {boolean} [copy] - If true, the data is copied, and the Buffer may be reused as soon as write returns.
  * @returns {void} No return value.
  */
 /**
@@ -318,6 +459,44 @@ exports.serviceAvailable  = require('./serviceAvailable').serviceAvailable;
  */
  exports.write             = require('./write').write;
 
+/**
+ * write several Buffers to a Ziti connection as one logical write.
+ * @function writev
+ * @param {number} conn - A Ziti connection handle.
+ * @param {Buffer[]} data - The segments to send, in order. They are not copied, except that a small segment is
+ * gathered into one message with the segments after it, up to 64 KiB; they must not be modified until onWrite fires.
+ * @param {onWriteCallback} onWrite - Called once, after every segment has been written.
+ * @returns {void} No return value.
+ */
+exports.writev            = require('./writev').writev;
+
+/**
+ * Hold back writes on a connection until a matching `uncork`, so that they are sent
+ * together as one message. Calls nest.
+ * @function cork
+ * @param {number} conn - A Ziti connection handle.
+ * @returns {void} No return value.
+ */
+exports.cork              = require('./cork').cork;
+
+/**
+ * Undo one `cork`. Once none remain, the held-back writes are sent; each still gets its own onWrite callback.
+ * @function uncork
+ * @param {number} conn - A Ziti connection handle.
+ * @returns {void} No return value.
+ */
+exports.uncork            = require('./uncork').uncork;
+
+/**
+ * Let small writes on a connection be held back for up to `delay` microseconds so they
+ * coalesce into fewer messages (sent early once 64 KiB are waiting). 0, the default, turns this off.
+ * @function setCoalesceDelay
+ * @param {number} conn - A Ziti connection handle.
+ * @param {number} delay - Delay, in microseconds.
+ * @returns {void} No return value.
+ */
+exports.setCoalesceDelay  = require('./setCoalesceDelay').setCoalesceDelay;
+
 const connect = require('./connect')
 exports.connect = connect.connect
 exports.httpAgent = connect.httpAgent
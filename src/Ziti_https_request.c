@@ -18,243 +18,379 @@ limitations under the License.
 #include <ziti/ziti_src.h>
 
 
-struct ListMap* HttpsClientListMap;
-struct ListMap* ServiceToHostnameListMap = NULL;
+// Allocations are aligned to this within an arena block
+#define HTTPS_ARENA_ALIGN 16
 
-struct hostname_port {
-    char* hostname;
-    int   port;
-};
-
-struct ListMap* newListMap() {
-    struct ListMap* listMap = calloc(1, sizeof *listMap);
-    return listMap;
+static size_t https_arena_align(size_t n) {
+  return (n + (HTTPS_ARENA_ALIGN - 1)) & ~((size_t)HTTPS_ARENA_ALIGN - 1);
 }
 
-uv_mutex_t client_pool_lock;
-
-bool listMapInsert(struct ListMap* collection, const char* key, void* value) {
-
-  if (collection->count == listMapCapacity) {
-    ZITI_NODEJS_LOG(ERROR, "collection->count already at capacity [%d], insert FAIL", listMapCapacity);
-    return false;
-  }
-
-  collection->kvPairs[collection->count].key = strdup(key);
-  collection->kvPairs[collection->count].value = value;
-  collection->count++;
-  ZITI_NODEJS_LOG(TRACE, "collection->count total is: [%zd]", collection->count);
-
-  return true;
+static HttpsArenaBlock* new_https_arena_block(size_t size) {
+  HttpsArenaBlock* block = malloc(size);
+  block->next = NULL;
+  block->size = size;
+  block->used = https_arena_align(sizeof(HttpsArenaBlock));
+  return block;
 }
 
-
-struct ListMap* getInnerListMapValueForKey(struct ListMap* collection, char* key) {
-  struct ListMap* value = NULL;
-  for (size_t i = 0 ; i < collection->count && value == NULL ; ++i) {
-    if (strcmp(collection->kvPairs[i].key, key) == 0) {
-      value = collection->kvPairs[i].value;
+/**
+ * Bump-allocate 'len' zeroed bytes that live until the request's arena is freed.
+ *
+ * Blocks added after the first are linked in right behind it, so the newest block (the only one with
+ * room worth using) is always arena->next, or the first block while it is alone.
+ */
+static void* https_arena_alloc(HttpsArenaBlock* arena, size_t len) {
+  len = https_arena_align(len);
+  HttpsArenaBlock* block = (arena->next != NULL) ? arena->next : arena;
+  if (block->size - block->used < len) {
+    size_t size = https_arena_align(sizeof(HttpsArenaBlock)) + len;
+    if (size < ZITI_NODEJS_HTTPS_ARENA_BLOCK_SIZE) {
+      size = ZITI_NODEJS_HTTPS_ARENA_BLOCK_SIZE;
     }
+    block = new_https_arena_block(size);
+    block->next = arena->next;
+    arena->next = block;
   }
-  return value;
+  void* p = (char*)block + block->used;
+  block->used += len;
+  memset(p, 0, len);
+  return p;
 }
 
-HttpsClient* getHttpsClientForKey(struct ListMap* collection, char* key) {
-  HttpsClient* value = NULL;
-  int busyCount = 0;
-  for (size_t i = 0 ; i < collection->count && value == NULL ; ++i) {
-    if (strcmp(collection->kvPairs[i].key, key) == 0) {
-      value = collection->kvPairs[i].value;
-      if (value->active) {      // if it's in use
-        value = NULL;           //  then keep searching
-      }
-      else if (value->purge) {  // if it's broken
-        value = NULL;           //  then keep searching
-      } else {
-        value->active = true;   // mark the one we will return as 'in use
-      }
-      busyCount++;
-    }
+static char* https_arena_strdup(HttpsArenaBlock* arena, const char* str) {
+  size_t len = strlen(str) + 1;
+  char* copy = https_arena_alloc(arena, len);
+  memcpy(copy, str, len);
+  return copy;
+}
+
+static void free_https_arena(HttpsArenaBlock* arena) {
+  while (arena != NULL) {
+    HttpsArenaBlock* next = arena->next;
+    free(arena);
+    arena = next;
   }
-  ZITI_NODEJS_LOG(DEBUG, "returning value '%p', collection->count is: [%zd], busy-count is: [%d]", value, collection->count, busyCount);
-  return value;
 }
 
-void freeListMap(struct ListMap* collection) {
-    if (collection == NULL) {
-        return;
-    }
-    for (size_t i = 0 ; i < collection->count ; ++i) {
-        free(collection->kvPairs[i].value);
-    }
-    free(collection);
+/**
+ * Start a request's arena, with its HttpsAddonData as the first allocation
+ */
+static HttpsAddonData* new_https_addon_data(void) {
+  HttpsArenaBlock* arena = new_https_arena_block(ZITI_NODEJS_HTTPS_ARENA_BLOCK_SIZE);
+  HttpsAddonData* addon_data = https_arena_alloc(arena, sizeof(HttpsAddonData));
+  addon_data->arena = arena;
+  addon_data->refs = 1;
+  return addon_data;
 }
 
+
 /**
- *
+ * Create a client for a pool. The caller puts it to use, or on the pool's idle list.
  */
-static int purge_and_replace_bad_clients(struct ListMap* clientListMap, HttpsAddonData* addon_data) {
-  int numReplaced = 0;
-  for (int i = 0; i < perKeyListMapCapacity; i++) {
+static HttpsClient* new_https_client(HttpsClientPool* pool, char* service) {
+
+  ZITI_NODEJS_LOG(DEBUG, "new client for %s, clients: %zu", pool->scheme_host_port, pool->client_count + 1);
 
-    HttpsClient* httpsClient = clientListMap->kvPairs[i].value;
+  HttpsClient* httpsClient = calloc(1, sizeof *httpsClient);
+  httpsClient->scheme_host_port = pool->scheme_host_port;
+  httpsClient->pool = pool;
 
-    if (httpsClient != NULL && httpsClient->purge) {
+  ZITI_NODEJS_LOG(DEBUG, "service is: %s, scheme_host_port is: %s", service, pool->scheme_host_port);
+  ziti_src_init(thread_loop, &(httpsClient->ziti_src), service, ztx );
+  tlsuv_http_init_with_src(thread_loop, &(httpsClient->client), pool->scheme_host_port, (tlsuv_src_t *)&(httpsClient->ziti_src) );
 
-      ZITI_NODEJS_LOG(DEBUG, "*********** purging client [%p] from slot [%d]", httpsClient, i);
+  pool->client_count++;
+  return httpsClient;
+}
 
-      // NOTE: We intentionally leak the old client's memory here.
-      // Calling tlsuv_http_close causes crashes because the async close
-      // conflicts with pending internal operations in the SDK.
-      // TODO: Find a way to properly clean up clients when they're purged.
-      // free(httpsClient->scheme_host_port);
-      // free(httpsClient);
+// Requests that have been given a client, and will be started on it from the next loop iteration
+static HttpsAddonData* ready_head = NULL;
+static HttpsAddonData* ready_tail = NULL;
+static uv_idle_t ready_idle;
+static bool ready_idle_initialized = false;
 
-      httpsClient = calloc(1, sizeof *httpsClient);
-      httpsClient->scheme_host_port = strdup(addon_data->scheme_host_port);
-      ziti_src_init(thread_loop, &(httpsClient->ziti_src), addon_data->service, ztx );
-      tlsuv_http_init_with_src(thread_loop, &(httpsClient->client), addon_data->scheme_host_port, (tlsuv_src_t *)&(httpsClient->ziti_src) );
+static void start_request(HttpsAddonData* addon_data);
 
-      clientListMap->kvPairs[i].value = httpsClient;
 
-      ZITI_NODEJS_LOG(DEBUG, "*********** new client [%p] now occupying slot [%d]", httpsClient, i);
+static void enqueue_request(HttpsAddonData** head, HttpsAddonData** tail, HttpsAddonData* addon_data) {
+  addon_data->next_waiter = NULL;
+  if (*tail != NULL) {
+    (*tail)->next_waiter = addon_data;
+  } else {
+    *head = addon_data;
+  }
+  *tail = addon_data;
+}
 
-      numReplaced++;
+static HttpsAddonData* dequeue_request(HttpsAddonData** head, HttpsAddonData** tail) {
+  HttpsAddonData* addon_data = *head;
+  if (addon_data != NULL) {
+    *head = addon_data->next_waiter;
+    if (*head == NULL) {
+      *tail = NULL;
     }
+    addon_data->next_waiter = NULL;
+  }
+  return addon_data;
+}
+
+
+static void on_ready_idle(uv_idle_t* handle) {
+  HttpsAddonData* addon_data = ready_head;
+  ready_head = ready_tail = NULL;
+  uv_idle_stop(handle);
+
+  while (addon_data != NULL) {
+    HttpsAddonData* next = addon_data->next_waiter;
+    addon_data->next_waiter = NULL;
+    start_request(addon_data);
+    release_https_request(addon_data);
+    addon_data = next;
   }
-  return numReplaced;
 }
 
 /**
- * 
+ * Start a request that now holds a client. This is deferred to the next loop iteration, since
+ * the client may be handed over from within a callback for the request that just released it.
  */
-static void allocate_client(uv_work_t* req) {
+static void schedule_request(HttpsAddonData* addon_data) {
+  // Kept until start_request has run, even if the request is cancelled (and completed) meanwhile
+  addon_data->refs++;
+  if (!ready_idle_initialized) {
+    uv_idle_init(thread_loop, &ready_idle);
+    ready_idle_initialized = true;
+  }
+  enqueue_request(&ready_head, &ready_tail, addon_data);
+  uv_idle_start(&ready_idle, on_ready_idle);
+}
 
-  ZITI_NODEJS_LOG(DEBUG, "allocate_client() entered, uv_work_t is: %p", req);
 
-  HttpsAddonData* addon_data = (HttpsAddonData*) req->data;
+/**
+ * Give a new request a client from the pool for its scheme_host_port, or queue it until one is released.
+ * Runs on the loop thread, as do all pool operations, so nothing here blocks or needs a lock.
+ */
+static void acquire_client(HttpsAddonData* addon_data) {
 
-  ZITI_NODEJS_LOG(DEBUG, "addon_data is: %p", addon_data);
+  ZITI_NODEJS_LOG(DEBUG, "acquire_client() entered, addon_data is: %p", addon_data);
 
-  // if (uv_mutex_trylock(&client_pool_lock)) {
-  //   ZITI_NODEJS_LOG(ERROR, "uv_mutex_lock failure");
-  // }
+  HttpsClientPool* pool = get_https_client_pool(addon_data->scheme_host_port, true);
 
-  struct ListMap* clientListMap = getInnerListMapValueForKey(HttpsClientListMap, addon_data->scheme_host_port);
+  // Requests already waiting for this pool go first. Otherwise reuse an idle client, or
+  // create one if the pool is still below its limit.
+  HttpsClient* httpsClient = NULL;
+  if (NULL == pool->waiters_head) {
+    httpsClient = pop_idle_https_client(pool);
+    if ((NULL == httpsClient) && (pool->client_count < pool->config.max_clients)) {
+      httpsClient = new_https_client(pool, addon_data->service);
+    }
+  }
 
-  if (NULL == clientListMap) { // If first time seeing this key, spawn a pool of clients for it
+  if (NULL == httpsClient) {
+    ZITI_NODEJS_LOG(DEBUG, "----------> all %zu clients busy, queueing addon_data: %p", pool->client_count, addon_data);
+    enqueue_request(&pool->waiters_head, &pool->waiters_tail, addon_data);
+    return;
+  }
 
-    clientListMap = newListMap();
-    listMapInsert(HttpsClientListMap, addon_data->scheme_host_port, (void*)clientListMap);
+  addon_data->httpsClient = httpsClient;
+  addon_data->httpsClient->active = true;
+  ZITI_NODEJS_LOG(DEBUG, "----------> client is: [%p]", addon_data->httpsClient);
 
-    uv_sem_init(&(clientListMap->sem), perKeyListMapCapacity);
+  schedule_request(addon_data);
+}
 
-    for (int i = 0; i < perKeyListMapCapacity; i++) {
 
-      HttpsClient* httpsClient = calloc(1, sizeof *httpsClient);
-      httpsClient->scheme_host_port = strdup(addon_data->scheme_host_port);
+/**
+ * Return a request's client to its pool. If requests are waiting, the client (or, if it had to be
+ * purged, a new one) goes straight to the oldest of them.
+ */
+void release_https_client(HttpsAddonData* addon_data) {
 
-      if (addon_data->haveURL) {
-        ZITI_NODEJS_LOG(DEBUG, "URL specified, so pasing NULL to ziti_src_init");
-        ziti_src_init(thread_loop, &(httpsClient->ziti_src), addon_data->service, ztx );
-      } else {
-        ZITI_NODEJS_LOG(DEBUG, "addon_data->service is: %s", addon_data->service);
-        ziti_src_init(thread_loop, &(httpsClient->ziti_src), addon_data->service, ztx );
-      }
+  HttpsClient* httpsClient = addon_data->httpsClient;
+  HttpsClientPool* pool = httpsClient->pool;
 
-      ZITI_NODEJS_LOG(DEBUG, "addon_data->scheme_host_port is: %s", addon_data->scheme_host_port);
-      tlsuv_http_init_with_src(thread_loop, &(httpsClient->client), addon_data->scheme_host_port, (tlsuv_src_t *)&(httpsClient->ziti_src) );
+  ZITI_NODEJS_LOG(DEBUG, "<--------- returning httpsClient [%p] back to pool", httpsClient);
+  httpsClient->active = false;
 
-      listMapInsert(clientListMap, addon_data->scheme_host_port, (void*)httpsClient);
+  // A client that hit an error never processes another request, so it is reclaimed
+  // (the next request on this pool gets a new client)
+  if (httpsClient->purge) {
+    ZITI_NODEJS_LOG(DEBUG, "*********** purging client [%p]", httpsClient);
+    close_https_client(httpsClient);
+    httpsClient = NULL;
+  }
 
+  HttpsAddonData* waiter = dequeue_request(&pool->waiters_head, &pool->waiters_tail);
+  if (NULL == waiter) {
+    if (NULL != httpsClient) {
+      push_idle_https_client(pool, httpsClient);
     }
+    return;
   }
-  else {
-
-    purge_and_replace_bad_clients(clientListMap, addon_data);
 
+  if (NULL == httpsClient) {
+    httpsClient = new_https_client(pool, waiter->service);
   }
 
-  ZITI_NODEJS_LOG(DEBUG, "----------> acquiring sem");
-  uv_sem_wait(&(clientListMap->sem));
-  ZITI_NODEJS_LOG(DEBUG, "----------> successfully acquired sem");
+  ZITI_NODEJS_LOG(DEBUG, "----------> handing client [%p] to waiting addon_data: %p", httpsClient, waiter);
 
-  addon_data->httpsClient = getHttpsClientForKey(clientListMap, addon_data->scheme_host_port);
-  ZITI_NODEJS_LOG(DEBUG, "----------> client is: [%p]", addon_data->httpsClient);
+  httpsClient->active = true;
+  waiter->httpsClient = httpsClient;
+  schedule_request(waiter);
+}
 
-  if (NULL == addon_data->httpsClient) {
-    ZITI_NODEJS_LOG(DEBUG, "----------> client is NULL, so we must purge_and_replace_bad_clients");
-    purge_and_replace_bad_clients(clientListMap, addon_data);
 
-    addon_data->httpsClient = getHttpsClientForKey(clientListMap, addon_data->scheme_host_port);
-    ZITI_NODEJS_LOG(DEBUG, "----------> client is: [%p]", addon_data->httpsClient);
-  }
+static void free_deadline_timer(uv_handle_t* handle) {
+  free(handle);
+}
 
-  if (NULL == addon_data->httpsClient) {
-    ZITI_NODEJS_LOG(DEBUG, "----------> client is NULL, so we are in an unrecoverable state!");
+static void close_deadline_timer(HttpsAddonData* addon_data) {
+  if (addon_data->deadline_timer != NULL) {
+    uv_close((uv_handle_t*)addon_data->deadline_timer, free_deadline_timer);
+    addon_data->deadline_timer = NULL;
   }
 }
 
+static void on_deadline(uv_timer_t* handle) {
+  HttpsAddonData* addon_data = (HttpsAddonData*) handle->data;
+  ZITI_NODEJS_LOG(DEBUG, "deadline passed for addon_data: %p", addon_data);
+  cancel_https_request(addon_data, UV_ETIMEDOUT);
+}
 
-struct hostname_port* getHostnamePortForService(const char* key) {
-
-  ZITI_NODEJS_LOG(TRACE, "getHostnamePortForService() entered, key: %s", key);
-
-  struct hostname_port* value = NULL;
+/**
+ * (Re)arm the deadline timer for whichever of the request's deadlines comes first, of those that still apply:
+ * the connect deadline until the request is issued on a client, the TTFB deadline until the response
+ * headers arrive, and the total deadline until the response is complete.
+ */
+static void arm_deadline(HttpsAddonData* addon_data) {
 
-  if (NULL != ServiceToHostnameListMap) {
+  if (addon_data->deadline_timer == NULL) {
+    return;
+  }
 
-    for (size_t i = 0 ; i < ServiceToHostnameListMap->count && value == NULL ; ++i) {
-      if (strcmp(ServiceToHostnameListMap->kvPairs[i].key, key) == 0) {
-        value = ServiceToHostnameListMap->kvPairs[i].value;
-        ZITI_NODEJS_LOG(TRACE, "getHostnamePortForService() found value->hostname is: [%s], port is: [%d]", value->hostname, value->port);
-      }
-    }
+  uint64_t deadline = addon_data->total_deadline;
+  if ((NULL == addon_data->httpsReq->req) && (0 != addon_data->connect_deadline) &&
+      ((0 == deadline) || (addon_data->connect_deadline < deadline))) {
+    deadline = addon_data->connect_deadline;
+  }
+  if (!addon_data->httpsReq->on_resp_has_fired && (0 != addon_data->ttfb_deadline) &&
+      ((0 == deadline) || (addon_data->ttfb_deadline < deadline))) {
+    deadline = addon_data->ttfb_deadline;
   }
 
-  ZITI_NODEJS_LOG(TRACE, "getHostnamePortForService() returning value '%p'", value);
+  if (0 == deadline) {
+    uv_timer_stop(addon_data->deadline_timer);
+    return;
+  }
 
-  return value;
+  uint64_t now = uv_now(thread_loop);
+  uv_timer_start(addon_data->deadline_timer, on_deadline, (deadline > now) ? (deadline - now) : 0, 0);
 }
 
 
 /**
- * 
+ * Complete a request that never reached tlsuv (or that tlsuv would not take) by passing JS an on_resp
+ * carrying the error 'code'
  */
-void track_service_to_hostname(const char* service_name, char* hostname, int port) {
+static void fail_https_request(HttpsAddonData* addon_data, int code) {
+
+  ZITI_NODEJS_LOG(DEBUG, "failing addon_data: %p, code: %d", addon_data, code);
 
-  ZITI_NODEJS_LOG(TRACE, "track_service_to_hostname() entered, service_name: %s hostname: %s port: %d", service_name, hostname, port);
+  HttpsReq* httpsReq = addon_data->httpsReq;
+  httpsReq->on_resp_has_fired = true;
+  httpsReq->respCode = code;
+  httpsReq->response_complete = true;
+  close_deadline_timer(addon_data);
 
-  if (NULL == ServiceToHostnameListMap) {
-    ServiceToHostnameListMap = newListMap();
+  // Body chunks written before the request could be issued fail along with it
+  fail_https_request_body(addon_data, code);
+  finish_https_request_body(addon_data);
+
+  HttpsRespItem* item = https_arena_alloc(addon_data->arena, sizeof(*item));
+  item->addon_data = addon_data;
+  item->code = code;
+  item->status = https_arena_strdup(addon_data->arena, uv_strerror(code));
+
+  if (addon_data->tsfn_on_resp != NULL) {
+    addon_data->refs++;
+    int rc = napi_call_threadsafe_function(
+        addon_data->tsfn_on_resp,
+        item,
+        napi_tsfn_blocking);
+    if (rc != napi_ok) {
+      addon_data->refs--;
+      ZITI_NODEJS_LOG(ERROR, "failure to invoke JS callback");
+    }
   }
 
-  struct hostname_port* value = getHostnamePortForService(service_name);
+  // The request is over; whoever called this still holds a reference of its own
+  release_https_request(addon_data);
+}
 
-  if (NULL == value) {
 
-    value = calloc(1, sizeof(*value));
-    value->hostname = strdup(hostname);
-    value->port = port;
+static void remove_waiter(HttpsAddonData* addon_data) {
+  HttpsClientPool* pool = get_https_client_pool(addon_data->scheme_host_port, false);
+  if (NULL == pool) {
+    return;
+  }
 
-    listMapInsert(ServiceToHostnameListMap, service_name, (void*)value);
+  HttpsAddonData* prev = NULL;
+  for (HttpsAddonData* waiter = pool->waiters_head; waiter != NULL; prev = waiter, waiter = waiter->next_waiter) {
+    if (waiter != addon_data) {
+      continue;
+    }
+    if (prev != NULL) {
+      prev->next_waiter = waiter->next_waiter;
+    } else {
+      pool->waiters_head = waiter->next_waiter;
+    }
+    if (pool->waiters_tail == waiter) {
+      pool->waiters_tail = prev;
+    }
+    waiter->next_waiter = NULL;
+    return;
+  }
+}
 
-    ZITI_NODEJS_LOG(TRACE, "track_service_to_hostname() inserting service_name: %s hostname: %s port: %d", service_name, hostname, port);
 
-  } else {
+/**
+ * Cancel a request that has not completed yet; JS's on_resp reports 'code' (UV_ETIMEDOUT or UV_ECANCELED).
+ * Whatever pool slot the request holds or is waiting for is given up, and a client that was
+ * part-way through the request is recycled rather than reused.
+ */
+void cancel_https_request(HttpsAddonData* addon_data, int code) {
 
-    value->hostname = strdup(hostname);
-    value->port = port;
+  HttpsReq* httpsReq = addon_data->httpsReq;
 
-    ZITI_NODEJS_LOG(TRACE, "track_service_to_hostname() updating service_name: %s hostname: %s port: %d", service_name, hostname, port);
+  if (httpsReq->response_complete || (0 != addon_data->cancel_code)) {
+    return;
+  }
+  addon_data->cancel_code = code;
 
+  ZITI_NODEJS_LOG(DEBUG, "cancelling addon_data: %p, code: %d", addon_data, code);
+
+  if (NULL == addon_data->httpsClient) {
+    // Still waiting for a client
+    remove_waiter(addon_data);
+    fail_https_request(addon_data, code);
+    return;
   }
+
+  if (NULL == httpsReq->req) {
+    // Holds a client but has not been issued on it yet; start_request gives the client back
+    fail_https_request(addon_data, code);
+    return;
+  }
+
+  // In progress: tlsuv fails the request through on_resp (or on_resp_body), which releases the client
+  addon_data->httpsClient->purge = true;
+  tlsuv_http_req_cancel(&(addon_data->httpsClient->client), httpsReq->req);
 }
 
 
 /**
  * Helper function to free HttpsAddonData and release associated resources.
- * Call this when the HTTP request is complete (EOF received or error occurred).
+ * Called (through release_https_request) once the request is complete and JS has seen the last of it,
+ * or directly when _Ziti_http_request fails before the request is queued.
  */
 static void free_https_addon_data(HttpsAddonData* addon_data) {
   if (addon_data == NULL) {
@@ -273,49 +409,75 @@ static void free_https_addon_data(HttpsAddonData* addon_data) {
   if (addon_data->tsfn_on_resp_body != NULL) {
     napi_release_threadsafe_function(addon_data->tsfn_on_resp_body, napi_tsfn_release);
   }
-  if (addon_data->tsfn_on_req_body != NULL) {
-    napi_release_threadsafe_function(addon_data->tsfn_on_req_body, napi_tsfn_release);
-  }
-
-  // Free allocated strings
-  if (addon_data->service != NULL) {
-    free(addon_data->service);
-  }
-  if (addon_data->scheme_host_port != NULL) {
-    free(addon_data->scheme_host_port);
-  }
-  if (addon_data->method != NULL) {
-    free(addon_data->method);
+  if (addon_data->on_req_body != NULL) {
+    release_dispatcher(addon_data->on_req_body);
   }
-  if (addon_data->path != NULL) {
-    free(addon_data->path);
+  if (addon_data->on_drain_ref != NULL) {
+    napi_delete_reference(addon_data->env, addon_data->on_drain_ref);
   }
+  close_deadline_timer(addon_data);
 
-  // Free header strings
-  for (uint32_t i = 0; i < addon_data->headers_array_length; i++) {
-    if (addon_data->header_name[i] != NULL) {
-      free(addon_data->header_name[i]);
-    }
-    if (addon_data->header_value[i] != NULL) {
-      free(addon_data->header_value[i]);
-    }
-  }
+  free_request_headers(&addon_data->headers);
 
-  // Free httpsReq
-  if (addon_data->httpsReq != NULL) {
-    free(addon_data->httpsReq);
+  // Free addon_data itself, along with its strings, httpsReq and response item
+  free_https_arena(addon_data->arena);
+}
+
+
+/**
+ * Drop a reference to a request, freeing it with the last one
+ */
+void release_https_request(HttpsAddonData* addon_data) {
+  if (--addon_data->refs == 0) {
+    free_https_addon_data(addon_data);
   }
+}
 
-  // Free any pending write chunks that were tracked
-  for (uint32_t i = 0; i < addon_data->pending_chunk_count; i++) {
-    if (addon_data->pending_chunks[i] != NULL) {
-      ZITI_NODEJS_LOG(DEBUG, "freeing pending chunk %p at index %d", addon_data->pending_chunks[i], i);
-      free(addon_data->pending_chunks[i]);
-    }
+// Tells our request handles apart from any other External passed in their place
+static const napi_type_tag https_req_type_tag = { 0x7a6974692d687474ULL, 0x70732d7265712d31ULL };
+
+static void release_https_req_handle(napi_env env, void* data, void* hint) {
+  (void) env;
+  (void) hint;
+  release_https_request(((HttpsReq*)data)->addon_data);
+}
+
+/**
+ * Invoked when the VM collects a request handle. Dropping the last reference frees the request, which
+ * deletes JS references, and that must not happen during GC, so it is deferred until GC is done.
+ */
+static void finalize_https_req_handle(node_api_nogc_env env, void* data, void* hint) {
+  node_api_post_finalizer(env, release_https_req_handle, data, hint);
+}
+
+/**
+ * Wrap a request in a JS handle (an External). The request stays allocated for as long as any handle
+ * to it is reachable, so httpRequestData/End/Cancel are safe to call on it at any time.
+ */
+napi_status create_https_req_handle(napi_env env, HttpsReq* httpsReq, napi_value* result) {
+  napi_status status = napi_create_external(env, httpsReq, finalize_https_req_handle, NULL, result);
+  if (status == napi_ok) {
+    status = napi_type_tag_object(env, *result, &https_req_type_tag);
+  }
+  if (status == napi_ok) {
+    httpsReq->addon_data->refs++;
   }
+  return status;
+}
 
-  // Free addon_data itself
-  free(addon_data);
+/**
+ * The request behind a handle made by create_https_req_handle; throws if 'js_req' is not one
+ */
+bool get_https_req(napi_env env, napi_value js_req, HttpsReq** result) {
+  bool is_req = false;
+  napi_valuetype valuetype;
+  if ((napi_typeof(env, js_req, &valuetype) == napi_ok) && (valuetype == napi_external) &&
+      (napi_check_object_type_tag(env, js_req, &https_req_type_tag, &is_req) == napi_ok) && is_req &&
+      (napi_get_value_external(env, js_req, (void**)result) == napi_ok)) {
+    return true;
+  }
+  napi_throw_error(env, "EINVAL", "req is not an HTTP request handle");
+  return false;
 }
 
 
@@ -406,10 +568,12 @@ static void CallJs_on_resp_body(napi_env env, napi_value js_cb, void* context, v
 
   // Free the HttpsRespBodyItem and its body (must happen even if env was NULL)
   if (item != NULL) {
+    HttpsAddonData* addon_data = item->addon_data;
     if (item->body != NULL) {
       free((void*)item->body);
     }
     free(item);
+    release_https_request(addon_data);
   }
 }
 
@@ -432,6 +596,7 @@ void on_resp_body(tlsuv_http_req_t *req, char *body, ssize_t len) {
   //  Grab everything off the tlsuv_http_resp_t that we need to eventually pass on to the JS on_resp_body callback.
   //  If we wait until CallJs_on_resp_body is invoked to do that work, the tlsuv_http_resp_t may have already been free'd by the C-SDK
 
+  item->addon_data = addon_data;
   item->req = req;
 
   if (NULL != body) {
@@ -442,20 +607,29 @@ void on_resp_body(tlsuv_http_req_t *req, char *body, ssize_t len) {
   }
   item->len = len;
 
-  // Determine if this is the final callback (EOF) - we'll release client AFTER accessing addon_data
-  bool is_eof = (NULL == body) && (UV_EOF == len);
+  // A request cancelled mid-body reports why it was cancelled
+  if ((NULL == body) && (len < 0) && (UV_EOF != len) && (0 != addon_data->cancel_code)) {
+    item->len = addon_data->cancel_code;
+  }
+
+  // Determine if this is the final callback (EOF, or an error) - we'll release client AFTER accessing addon_data
+  bool is_eof = (NULL == body) && (len < 0);
 
   ZITI_NODEJS_LOG(DEBUG, "calling tsfn_on_resp_body: %p", addon_data->tsfn_on_resp_body);
 
   // Initiate the call into the JavaScript callback.
   // IMPORTANT: Do this BEFORE releasing the client back to the pool to avoid use-after-free
   // if another thread grabs the client and overwrites addon_data fields.
+  addon_data->refs++;
   int rc = napi_call_threadsafe_function(
       addon_data->tsfn_on_resp_body,
       item,
       napi_tsfn_blocking);
   if (rc != napi_ok) {
+    addon_data->refs--;
     napi_throw_error(addon_data->env, "EINVAL", "failure to invoke JS callback");
+    free((void*)item->body);
+    free(item);
   }
 
   // Handle response completion
@@ -467,24 +641,26 @@ void on_resp_body(tlsuv_http_req_t *req, char *body, ssize_t len) {
       httpsReq->response_complete = true;
       ZITI_NODEJS_LOG(DEBUG, "response_complete=true, pending_write_count=%d", httpsReq->pending_write_count);
     }
+    close_deadline_timer(addon_data);
+
+    // A client whose response failed part-way is not reused
+    if (UV_EOF != len) {
+      addon_data->httpsClient->purge = true;
+    }
 
     // Only release client if all pending writes are also complete
     // If writes are still pending, on_req_body will release the client when the last write completes
     if (httpsReq == NULL || httpsReq->pending_write_count == 0) {
-      ZITI_NODEJS_LOG(DEBUG, "<--------- returning httpsClient [%p] back to pool", addon_data->httpsClient);
-      addon_data->httpsClient->active = false;
-
       // NOTE: Do NOT mark client for purge on successful completion
       // Purging is only for error cases - reusing healthy clients is fine
-
-      struct ListMap* clientListMap = getInnerListMapValueForKey(HttpsClientListMap, addon_data->scheme_host_port);
-
-      ZITI_NODEJS_LOG(DEBUG, "<-------- returning sem for client: [%p] ", addon_data->httpsClient);
-      uv_sem_post(&(clientListMap->sem));
-      ZITI_NODEJS_LOG(DEBUG, "          after returning sem for client: [%p] ", addon_data->httpsClient);
+      release_https_client(addon_data);
+      finish_https_request_body(addon_data);
     } else {
       ZITI_NODEJS_LOG(DEBUG, "deferring client release - %d writes still pending", httpsReq->pending_write_count);
     }
+
+    // tlsuv is done with the request
+    release_https_request(addon_data);
   }
 
 }
@@ -557,56 +733,32 @@ static void CallJs_on_resp(napi_env env, napi_value js_cb, void* context, void*
     }
     ZITI_NODEJS_LOG(DEBUG, "status: %s", item->status);
 
-    // const headers = {}
-    tlsuv_http_hdr *h;
-    int i = 0;
-    napi_value js_headers, js_header_value;
-    napi_value js_cookies_array = NULL;
+    // obj.rawHeaders = [ name, value, name, value, ... ], as in Node's IncomingMessage.rawHeaders
+    // (lib/httpRequest.js builds obj.headers from it if asked for)
+    napi_value js_raw_headers, js_header_string;
 
-    rc = napi_create_object(env, &js_headers);
+    rc = napi_create_array_with_length(env, 2 * item->header_count, &js_raw_headers);
     if (rc != napi_ok) {
-      napi_throw_error(env, "EINVAL", "failure to create js_headers object");
+      napi_throw_error(env, "EINVAL", "failure to create js_raw_headers array");
     }
 
-    for (h = item->headers; h != NULL && h->name != NULL; h++) {
-
-      if (strcasecmp(h->name, "set-cookie") == 0) {
-        if (NULL == js_cookies_array) {
-          rc = napi_create_array(env, &js_cookies_array);
-          if (rc != napi_ok) {
-            napi_throw_error(env, "EINVAL", "failure to create js_cookies_array");
-          }
-        }
-        rc = napi_create_string_utf8(env, (const char*)h->value, strlen(h->value), &js_header_value);
-        if (rc != napi_ok) {
-          napi_throw_error(env, "EINVAL", "failure to create js_header_value");
-        }
-        rc = napi_set_element(env, js_cookies_array, i++, js_header_value);
-        if (rc != napi_ok) {
-          napi_throw_error(env, "EINVAL", "failure to set js_header_element");
-        }
-      } else {
-        rc = napi_create_string_utf8(env, (const char*)h->value, strlen(h->value), &js_header_value);
-        if (rc != napi_ok) {
-          napi_throw_error(env, "EINVAL", "failure to create js_header_value");
-        }
-        rc = napi_set_named_property(env, js_headers, h->name, js_header_value);
-        if (rc != napi_ok) {
-          napi_throw_error(env, "EINVAL", "failure to set header");
-        }
+    const char* p = item->status + strlen(item->status) + 1;
+    for (uint32_t i = 0; i < 2 * item->header_count; i++) {
+      size_t len = strlen(p);
+      rc = napi_create_string_utf8(env, p, len, &js_header_string);
+      if (rc != napi_ok) {
+        napi_throw_error(env, "EINVAL", "failure to create js_header_string");
       }
-    }
-    if (NULL != js_cookies_array) {
-      rc = napi_set_named_property(env, js_headers, "Set-Cookie", js_cookies_array);
+      rc = napi_set_element(env, js_raw_headers, i, js_header_string);
       if (rc != napi_ok) {
-        napi_throw_error(env, "EINVAL", "failure to set set-cookie header");
+        napi_throw_error(env, "EINVAL", "failure to set js_raw_headers element");
       }
+      p += len + 1;
     }
 
-    // obj.headers = headers
-    rc = napi_set_named_property(env, js_http_item, "headers", js_headers);
+    rc = napi_set_named_property(env, js_http_item, "rawHeaders", js_raw_headers);
     if (rc != napi_ok) {
-      napi_throw_error(env, "EINVAL", "failure to set named property headers");
+      napi_throw_error(env, "EINVAL", "failure to set named property rawHeaders");
     }
 
     // Call the JavaScript function and pass it the HttpsRespItem
@@ -624,23 +776,20 @@ static void CallJs_on_resp(napi_env env, napi_value js_cb, void* context, void*
 
   }
 
-  // Free the HttpsRespItem and its members (must happen even if env was NULL)
-  if (item != NULL) {
-    if (item->headers != NULL) {
-      for (tlsuv_http_hdr *hdr = item->headers; hdr->name != NULL; hdr++) {
-        free(hdr->name);
-        free(hdr->value);
-      }
-      free(item->headers);
-    }
-    if (item->status != NULL) {
-      free(item->status);
-    }
-    free(item);
-  }
+  // The HttpsRespItem belongs to the request's arena, which goes once nothing references the request
+  release_https_request(item->addon_data);
 }
 
 
+/**
+ * Copy a NUL-terminated string into the packed status/headers and return the position after its NUL
+ */
+static char* arena_put(char* p, const char* str) {
+  size_t len = strlen(str) + 1;
+  memcpy(p, str, len);
+  return p + len;
+}
+
 /**
  *
  */
@@ -650,41 +799,47 @@ void on_resp(tlsuv_http_resp_t *resp, void *data) {
   HttpsAddonData* addon_data = (HttpsAddonData*) data;
   ZITI_NODEJS_LOG(DEBUG, "addon_data->httpsReq is: %p", addon_data->httpsReq);
 
+  // A request we cancelled is reported with the reason it was cancelled
+  int resp_code = resp->code;
+  if ((resp_code < 0) && (0 != addon_data->cancel_code)) {
+    resp_code = addon_data->cancel_code;
+  }
+
   addon_data->httpsReq->on_resp_has_fired = true;
-  addon_data->httpsReq->respCode = resp->code;
+  addon_data->httpsReq->respCode = resp_code;
 
-  HttpsRespItem* item = calloc(1, sizeof(*item));
+  HttpsRespItem* item = https_arena_alloc(addon_data->arena, sizeof(*item));
   ZITI_NODEJS_LOG(DEBUG, "new HttpsRespItem is: %p", item);
   
   //  Grab everything off the tlsuv_http_resp_t that we need to eventually pass on to the JS on_resp callback.
   //  If we wait until CallJs_on_resp is invoked to do that work, the tlsuv_http_resp_t may have already been free'd by the C-SDK
 
+  item->addon_data = addon_data;
   item->req = resp->req;
   ZITI_NODEJS_LOG(DEBUG, "item->req: %p", item->req);
 
-  item->code = resp->code;
+  item->code = resp_code;
   ZITI_NODEJS_LOG(DEBUG, "item->code: %d", item->code);
 
-  item->status = strdup(resp->status);
-  ZITI_NODEJS_LOG(DEBUG, "item->status: %s", item->status);
-
-  int header_cnt = 0;
+  // Pack the status and headers into one allocation: "status\0name\0value\0..."
+  const char* status = (resp->status != NULL) ? resp->status : "";
+  size_t arena_len = strlen(status) + 1;
   tlsuv_http_hdr *h;
   LIST_FOREACH(h, &resp->headers, _next) {
-    header_cnt++;
+    arena_len += strlen(h->name) + 1 + strlen(h->value) + 1;
+    item->header_count++;
   }
-  ZITI_NODEJS_LOG(DEBUG, "header_cnt: %d", header_cnt);
+  ZITI_NODEJS_LOG(DEBUG, "header_count: %u, arena_len: %zu", item->header_count, arena_len);
 
-  item->headers = calloc(header_cnt + 1, sizeof(tlsuv_http_hdr));
-  header_cnt = 0;
+  char* p = item->status = https_arena_alloc(addon_data->arena, arena_len);
+  p = arena_put(p, status);
   LIST_FOREACH(h, &resp->headers, _next) {
-    item->headers[header_cnt].name = strdup(h->name);
-    item->headers[header_cnt].value = strdup(h->value);
-    ZITI_NODEJS_LOG(DEBUG, "item->headers[%d]: %s : %s", header_cnt, item->headers[header_cnt].name, item->headers[header_cnt].value);
-    header_cnt++;
+    p = arena_put(p, h->name);
+    p = arena_put(p, h->value);
   }
+  ZITI_NODEJS_LOG(DEBUG, "item->status: %s", item->status);
 
-  if ((UV_EOF == resp->code) || (resp->code < 0)) {
+  if ((UV_EOF == resp_code) || (resp_code < 0)) {
     HttpsReq* httpsReq = addon_data->httpsReq;
 
     // Mark response as complete (even on error)
@@ -693,22 +848,18 @@ void on_resp(tlsuv_http_resp_t *resp, void *data) {
       ZITI_NODEJS_LOG(DEBUG, "error case: response_complete=true, pending_write_count=%d",
                       httpsReq->pending_write_count);
     }
+    close_deadline_timer(addon_data);
 
-    // Before we fully release this client (via semaphore post) let's indicate purge is needed, because after errs happen on a client,
+    // Before we fully release this client back to the pool let's indicate purge is needed, because after errs happen on a client,
     // subsequent requests using that client never get processed.
     ZITI_NODEJS_LOG(DEBUG, "*********** due to error, purge now necessary for client: [%p]", addon_data->httpsClient);
     addon_data->httpsClient->purge = true;
 
     // Only release client if all pending writes are also complete
     if (httpsReq == NULL || httpsReq->pending_write_count == 0) {
-      ZITI_NODEJS_LOG(ERROR, "<--------- returning httpsClient [%p] back to pool due to error: [%d]", addon_data->httpsClient, resp->code);
-      addon_data->httpsClient->active = false;
-
-      struct ListMap* clientListMap = getInnerListMapValueForKey(HttpsClientListMap, addon_data->scheme_host_port);
-
-      ZITI_NODEJS_LOG(DEBUG, "<-------- returning sem for client: [%p] ", addon_data->httpsClient);
-      uv_sem_post(&(clientListMap->sem));
-      ZITI_NODEJS_LOG(DEBUG, "          after returning sem for client: [%p] ", addon_data->httpsClient);
+      ZITI_NODEJS_LOG(ERROR, "<--------- returning httpsClient [%p] back to pool due to error: [%d]", addon_data->httpsClient, resp_code);
+      release_https_client(addon_data);
+      finish_https_request_body(addon_data);
     } else {
       ZITI_NODEJS_LOG(DEBUG, "deferring client release - %d writes still pending", httpsReq->pending_write_count);
     }
@@ -716,24 +867,28 @@ void on_resp(tlsuv_http_resp_t *resp, void *data) {
 
   // Initiate the call into the JavaScript callback. The call into JavaScript will not have happened when this function returns, but it will be queued.
   if (addon_data->tsfn_on_resp != NULL) {
+    addon_data->refs++;
     int rc = napi_call_threadsafe_function(
         addon_data->tsfn_on_resp,
         item,
         napi_tsfn_blocking);
     if (rc != napi_ok) {
+      addon_data->refs--;
       napi_throw_error(addon_data->env, "EINVAL", "failure to invoke JS callback");
     }
   }
 
-  if (UV_EOF != resp->code && resp->code >= 0) {
+  if (UV_EOF != resp_code && resp_code >= 0) {
+    // Headers are in, so only the total deadline still applies
+    arm_deadline(addon_data);
+
     // We need body of the HTTP response, so wire up that callback now
-    // Note: Don't set body_cb if we already released the client due to an error (resp->code < 0)
-    // Otherwise on_resp_body could fire later and double-post the semaphore
+    // Note: Don't set body_cb if we already released the client due to an error (resp_code < 0)
+    // Otherwise on_resp_body could fire later and release the client a second time
     resp->body_cb = on_resp_body;
   } else {
-    // TODO: Temporarily disabled to debug SEGV crash in link_write_cb
-    // Error case: body_cb won't be called, so free addon_data now
-    // free_https_addon_data(addon_data);
+    // Error case: body_cb won't be called, so tlsuv is done with the request
+    release_https_request(addon_data);
   }
 }
 
@@ -771,7 +926,7 @@ static void CallJs_on_req(napi_env env, napi_value js_cb, void* context, void* d
     }
 
     // obj.req = req
-    napi_create_int64(env, (int64_t)addon_data->httpsReq, &js_req);
+    rc = create_https_req_handle(env, addon_data->httpsReq, &js_req);
     if (rc != napi_ok) {
       napi_throw_error(env, "EINVAL", "failure to create resp.req");
     }
@@ -795,19 +950,26 @@ static void CallJs_on_req(napi_env env, napi_value js_cb, void* context, void* d
     }
 
   }
+
+  // Taken by start_request
+  release_https_request(addon_data);
 }
 
 
 /**
- * 
+ * Issue the request on the client it was given by acquire_client or release_https_client
  */
-void on_client(uv_work_t* req, int status) {
+static void start_request(HttpsAddonData* addon_data) {
 
-  ZITI_NODEJS_LOG(DEBUG, "on_client() entered, uv_work_t is: %p, status is: %d", req, status);
-
-  HttpsAddonData* addon_data = (HttpsAddonData*) req->data;
+  ZITI_NODEJS_LOG(DEBUG, "start_request() entered, addon_data is: %p", addon_data);
   ZITI_NODEJS_LOG(DEBUG, "client is: [%p]", addon_data->httpsClient);
 
+  // Cancelled (and already reported to JS) while waiting to start
+  if (0 != addon_data->cancel_code) {
+    release_https_client(addon_data);
+    return;
+  }
+
   // Initiate the request:   HTTP -> TLS -> Ziti -> Service 
   tlsuv_http_req_t *r = tlsuv_http_req(
     &(addon_data->httpsClient->client),
@@ -821,29 +983,38 @@ void on_client(uv_work_t* req, int status) {
 
   if (r == NULL) {
     ZITI_NODEJS_LOG(ERROR, "tlsuv_http_req returned NULL - request failed to initialize");
+    addon_data->httpsClient->purge = true;
+    fail_https_request(addon_data, UV_EINVAL);
+    release_https_client(addon_data);
     return;
   }
 
   addon_data->httpsReq->req = r;
+  arm_deadline(addon_data);
 
   // Explicitly set req->data so on_resp_body can reliably access addon_data
   // (don't rely on tlsuv_http_req storing the data parameter in req->data)
   r->data = addon_data;
 
-  // Add headers to request
-  for (int i = 0; i < (int)addon_data->headers_array_length; i++) {
-    tlsuv_http_req_header(r, addon_data->header_name[i], addon_data->header_value[i]);
-    // free(addon_data->header_name[i]);
-    // free(addon_data->header_value[i]);
+  // Add headers to request; tlsuv has its own copies now
+  apply_request_headers(r, &addon_data->headers);
+  free_request_headers(&addon_data->headers);
+
+  // Hand tlsuv the body chunks (and the end) JS sent while the request waited to be issued
+  flush_https_request_body(addon_data);
+  if (addon_data->httpsReq->end_pending) {
+    tlsuv_http_req_end(r);
   }
 
   // Initiate the call into the JavaScript callback. The call into JavaScript will not have happened when this function returns, but it will be queued.
   if (addon_data->tsfn_on_req != NULL) {
+    addon_data->refs++;
     int rc = napi_call_threadsafe_function(
         addon_data->tsfn_on_req,
         addon_data,
         napi_tsfn_blocking);
     if (rc != napi_ok) {
+      addon_data->refs--;
       napi_throw_error(addon_data->env, "EINVAL", "failure to invoke JS callback");
     }
   }
@@ -852,6 +1023,29 @@ void on_client(uv_work_t* req, int status) {
 
 
 
+static bool get_request_option(napi_env env, napi_value js_options, const char* name, int64_t* value) {
+  bool has;
+  napi_value js_value;
+  napi_valuetype valuetype;
+
+  if ((napi_has_named_property(env, js_options, name, &has) != napi_ok) || !has) {
+    return true;
+  }
+  if ((napi_get_named_property(env, js_options, name, &js_value) != napi_ok) ||
+      (napi_typeof(env, js_value, &valuetype) != napi_ok)) {
+    return false;
+  }
+  if (valuetype == napi_undefined) {
+    return true;
+  }
+  if ((napi_get_value_int64(env, js_value, value) != napi_ok) || (*value < 0)) {
+    napi_throw_error(env, "EINVAL", "timeouts and highWaterMark must be non-negative numbers");
+    return false;
+  }
+  return true;
+}
+
+
 /**
  * Initiate an HTTPS request
  * 
@@ -859,11 +1053,18 @@ void on_client(uv_work_t* req, int status) {
  * @param {string}   [1] method
  * @param {string}   [2] path                      path part of the URL including query params
  * @param {string[]} [3] headers;                  Array of strings of the form "name:value"
- * @param {func}     [4] JS on_req  callback;      This is invoked from 'on_client' function above
+ * @param {func}     [4] JS on_req  callback;      This is invoked from 'start_request' function above
  * @param {func}     [5] JS on_resp callback;      This is invoked from 'on_resp' function above
  * @param {func}     [6] JS on_resp_data callback; This is invoked from 'on_resp_data' function above
+ * @param {object}   [8] pool settings (optional); { minIdle, maxClients, idleTimeoutMs } for this scheme_host_port
+ * @param {object}   [9] options (optional);        { connectTimeoutMs, ttfbTimeoutMs, timeoutMs }; when one passes,
+ *                                                 the request is cancelled and on_resp reports UV_ETIMEDOUT;
+ *                                                 { highWaterMark } bytes of body that may be waiting before
+ *                                                 _Ziti_http_request_data returns false
  * 
- * @returns {tlsuv_http_req_t} req  This allows the JS to subsequently write the Body to the request (see _Ziti_http_request_data)
+ * @returns {External} req  This allows the JS to subsequently write the Body to the request (see _Ziti_http_request_data),
+ *                          or to cancel it (see _Ziti_http_request_cancel), from the moment it is returned: the
+ *                          body and end are held until the request is issued on a client
 
  */
 napi_value _Ziti_http_request(napi_env env, const napi_callback_info info) {
@@ -875,12 +1076,12 @@ napi_value _Ziti_http_request(napi_env env, const napi_callback_info info) {
 
   ZITI_NODEJS_LOG(DEBUG, "entered");
 
-  if (NULL == HttpsClientListMap) {
-    HttpsClientListMap = newListMap();
+  if (reject_on_net_thread(env, "httpRequest")) {
+    return NULL;
   }
 
-  size_t argc = 8;
-  napi_value args[8];
+  size_t argc = 10;
+  napi_value args[10];
   status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   if (status != napi_ok) {
     napi_throw_error(env, NULL, "Failed to parse arguments");
@@ -892,7 +1093,7 @@ napi_value _Ziti_http_request(napi_env env, const napi_callback_info info) {
     return NULL;
   }
 
-  HttpsAddonData* addon_data = calloc(1, sizeof(HttpsAddonData));
+  HttpsAddonData* addon_data = new_https_addon_data();
   ZITI_NODEJS_LOG(DEBUG, "allocated addon_data : %p", addon_data);
   addon_data->env = env;
 
@@ -917,10 +1118,12 @@ napi_value _Ziti_http_request(napi_env env, const napi_callback_info info) {
 
   if (serviceNameSpecified && schemeHostPortSpecified) {
     napi_throw_error(env, "EINVAL", "both serviceName and schemeHostPort were specified; they are mutually exclusive");
+    free_https_addon_data(addon_data);
     return NULL;
   }
   if (!serviceNameSpecified && !schemeHostPortSpecified) {
     napi_throw_error(env, "EINVAL", "both serviceName and schemeHostPort were unspecified; must specify one");
+    free_https_addon_data(addon_data);
     return NULL;
   }
 
@@ -932,14 +1135,16 @@ napi_value _Ziti_http_request(napi_env env, const napi_callback_info info) {
     status = napi_get_value_string_utf8(env, args[0], NULL, 0, &serviceName_len);
     if (status != napi_ok) {
       napi_throw_error(env, "EINVAL", "serviceName is not a string");
+      free_https_addon_data(addon_data);
       return NULL;
     }
 
     // Obtain serviceName
-    serviceName = calloc(1, serviceName_len+2);
+    serviceName = https_arena_alloc(addon_data->arena, serviceName_len+1);
     status = napi_get_value_string_utf8(env, args[0], serviceName, serviceName_len+1, &result);
     if (status != napi_ok) {
       napi_throw_error(env, "EINVAL", "Failed to obtain serviceName");
+      free_https_addon_data(addon_data);
       return NULL;
     }
   }
@@ -952,14 +1157,16 @@ napi_value _Ziti_http_request(napi_env env, const napi_callback_info info) {
     status = napi_get_value_string_utf8(env, args[1], NULL, 0, &schemeHostPort_len);
     if (status != napi_ok) {
       napi_throw_error(env, "EINVAL", "schemeHostPort is not a string");
+      free_https_addon_data(addon_data);
       return NULL;
     }
 
     // Obtain schemeHostPort
-    schemeHostPort = calloc(1, schemeHostPort_len+2);
+    schemeHostPort = https_arena_alloc(addon_data->arena, schemeHostPort_len+1);
     status = napi_get_value_string_utf8(env, args[1], schemeHostPort, schemeHostPort_len+1, &result);
     if (status != napi_ok) {
       napi_throw_error(env, "EINVAL", "Failed to obtain schemeHostPort");
+      free_https_addon_data(addon_data);
       return NULL;
     }
   
@@ -967,54 +1174,66 @@ napi_value _Ziti_http_request(napi_env env, const napi_callback_info info) {
     rc = tlsuv_parse_url(&url_parse, schemeHostPort);
     if (rc != 0) {
       napi_throw_error(env, "EINVAL", "schemeHostPort is not a valid URL");
+      free_https_addon_data(addon_data);
       return NULL;
     }
 
-    addon_data->scheme_host_port = strdup(schemeHostPort);
+    addon_data->scheme_host_port = schemeHostPort;
     addon_data->haveURL = true;
 
   } else if (serviceNameSpecified) {
 
-    struct hostname_port* hostname_port = NULL;
-
-    hostname_port = getHostnamePortForService(serviceName);
-    if (NULL == hostname_port) {
+    int port = 0;
+    const ServiceHostnameEntry* entry = get_service_hostname(serviceName, &port);
+    if (NULL == entry) {
       napi_throw_error(env, "EINVAL", "Unknown serviceName");
+      free_https_addon_data(addon_data);
       return NULL;
     }
-    addon_data->service = strdup(serviceName);
+    addon_data->service = serviceName;
 
     ZITI_NODEJS_LOG(DEBUG, "addon_data->service: %s", addon_data->service);
 
-    addon_data->scheme_host_port = calloc(1, 100);
+    size_t scheme_host_port_len = strlen(entry->hostname) + sizeof("https://:65535");
+    addon_data->scheme_host_port = https_arena_alloc(addon_data->arena, scheme_host_port_len);
 
-    if (hostname_port->port == 443) {
-      strcat(addon_data->scheme_host_port, "https://");
-      strcat(addon_data->scheme_host_port, hostname_port->hostname);
+    if (port == 443) {
+      snprintf(addon_data->scheme_host_port, scheme_host_port_len, "https://%s", entry->hostname);
     } else {
-      strcat(addon_data->scheme_host_port, "http://");
-      strcat(addon_data->scheme_host_port, hostname_port->hostname);
-      strcat(addon_data->scheme_host_port, ":");
-      char sport[8];
-      sprintf(sport, "%d", hostname_port->port);
-      strcat(addon_data->scheme_host_port, sport);
+      snprintf(addon_data->scheme_host_port, scheme_host_port_len, "http://%s:%d", entry->hostname, port);
     }
   }
 
   ZITI_NODEJS_LOG(DEBUG, "scheme_host_port: %s, haveURL: %d", addon_data->scheme_host_port, addon_data->haveURL);
 
+  // Obtain (optional) pool settings; they apply to the pool for this scheme_host_port from now on
+  if (argc > 8) {
+    status = napi_typeof(env, args[8], &valuetype);
+    if ((status == napi_ok) && (valuetype == napi_object)) {
+      HttpsClientPool* pool = get_https_client_pool(addon_data->scheme_host_port, true);
+      HttpsPoolConfig config = pool->config;
+      if (!get_https_pool_config(env, args[8], &config)) {
+        free_https_addon_data(addon_data);
+        return NULL;
+      }
+      pool->config = config;
+    }
+  }
+
   // Obtain method length
   size_t method_len;
   status = napi_get_value_string_utf8(env, args[2], NULL, 0, &method_len);
   if (status != napi_ok) {
     napi_throw_error(env, "EINVAL", "method is not a string");
+    free_https_addon_data(addon_data);
     return NULL;
   }
   // Obtain method
-  addon_data->method = calloc(1, method_len+2);
+  addon_data->method = https_arena_alloc(addon_data->arena, method_len+1);
   status = napi_get_value_string_utf8(env, args[2], addon_data->method, method_len+1, &result);
   if (status != napi_ok) {
     napi_throw_error(env, "EINVAL", "Failed to obtain method");
+    free_https_addon_data(addon_data);
     return NULL;
   }
 
@@ -1025,19 +1244,21 @@ napi_value _Ziti_http_request(napi_env env, const napi_callback_info info) {
   status = napi_get_value_string_utf8(env, args[3], NULL, 0, &path_len);
   if (status != napi_ok) {
     napi_throw_error(env, "EINVAL", "path is not a string");
+    free_https_addon_data(addon_data);
     return NULL;
   }
   // Obtain path
-  addon_data->path = calloc(1, path_len+2);
+  addon_data->path = https_arena_alloc(addon_data->arena, path_len+1);
   status = napi_get_value_string_utf8(env, args[3], addon_data->path, path_len+1, &result);
   if (status != napi_ok) {
     napi_throw_error(env, "EINVAL", "Failed to obtain path");
+    free_https_addon_data(addon_data);
     return NULL;
   }
 
   ZITI_NODEJS_LOG(DEBUG, "path: %s", addon_data->path);
 
-  HttpsReq* httpsReq = calloc(1, sizeof(HttpsReq));
+  HttpsReq* httpsReq = https_arena_alloc(addon_data->arena, sizeof(HttpsReq));
   addon_data->httpsReq = httpsReq;
   httpsReq->addon_data = addon_data;
 
@@ -1053,6 +1274,7 @@ napi_value _Ziti_http_request(napi_env env, const napi_callback_info info) {
     rc = napi_create_string_utf8(env, "on_req", NAPI_AUTO_LENGTH, &work_name);
     if (rc != napi_ok) {
       napi_throw_error(env, "EINVAL", "Failed to create string");
+      free_https_addon_data(addon_data);
       return NULL;
     }
 
@@ -1074,6 +1296,7 @@ napi_value _Ziti_http_request(napi_env env, const napi_callback_info info) {
     ZITI_NODEJS_LOG(DEBUG, "2: %d", rc);
     if (rc != napi_ok) {
       napi_throw_error(env, "EINVAL", "Failed to create threadsafe_function");
+      free_https_addon_data(addon_data);
       return NULL;
     }
     ZITI_NODEJS_LOG(DEBUG, "napi_create_threadsafe_function addon_data->tsfn_on_req() : %p", addon_data->tsfn_on_req);
@@ -1093,6 +1316,7 @@ napi_value _Ziti_http_request(napi_env env, const napi_callback_info info) {
     rc = napi_create_string_utf8(env, "on_resp", NAPI_AUTO_LENGTH, &work_name);
     if (rc != napi_ok) {
       napi_throw_error(env, "EINVAL", "Failed to create string");
+      free_https_addon_data(addon_data);
       return NULL;
     }
 
@@ -1113,6 +1337,7 @@ napi_value _Ziti_http_request(napi_env env, const napi_callback_info info) {
     );
     if (rc != napi_ok) {
       napi_throw_error(env, "EINVAL", "Failed to create threadsafe_function");
+      free_https_addon_data(addon_data);
       return NULL;
     }
     ZITI_NODEJS_LOG(DEBUG, "napi_create_threadsafe_function addon_data->tsfn_on_resp() : %p", addon_data->tsfn_on_resp);
@@ -1129,6 +1354,7 @@ napi_value _Ziti_http_request(napi_env env, const napi_callback_info info) {
   rc = napi_create_string_utf8(env, "on_resp_data", NAPI_AUTO_LENGTH, &work_name);
   if (rc != napi_ok) {
     napi_throw_error(env, "EINVAL", "Failed to create string");
+    free_https_addon_data(addon_data);
     return NULL;
   }
 
@@ -1149,6 +1375,7 @@ napi_value _Ziti_http_request(napi_env env, const napi_callback_info info) {
   );
   if (rc != napi_ok) {
     napi_throw_error(env, "EINVAL", "Failed to create threadsafe_function");
+    free_https_addon_data(addon_data);
     return NULL;
   }
   ZITI_NODEJS_LOG(DEBUG, "napi_create_threadsafe_function addon_data->tsfn_on_resp_body() : %p", addon_data->tsfn_on_resp_body);
@@ -1156,75 +1383,57 @@ napi_value _Ziti_http_request(napi_env env, const napi_callback_info info) {
   //
   // Capture headers
   //
-  uint32_t i;
-  status = napi_get_array_length(env, args[4], &addon_data->headers_array_length);
-  if (status != napi_ok) {
-    napi_throw_error(env, "EINVAL", "Failed to obtain headers array");
+  int headers_rc = capture_request_headers(env, args[4], &addon_data->headers);
+  if (headers_rc < 0) {
+    free_https_addon_data(addon_data);
     return NULL;
   }
-  ZITI_NODEJS_LOG(DEBUG, "headers_array_length: %d", addon_data->headers_array_length);
-  for (i = 0; i < addon_data->headers_array_length; i++) {
-
-    napi_value headers_array_element;
-    status = napi_get_element(env, args[4], i, &headers_array_element);
-    if (status != napi_ok) {
-      napi_throw_error(env, "EINVAL", "Failed to obtain headers element");
-      return NULL;
-    }
-
-    // Obtain element length
-    size_t element_len;
-    status = napi_get_value_string_utf8(env, headers_array_element, NULL, 0, &element_len);
-    if (status != napi_ok) {
-      napi_throw_error(env, "EINVAL", "header arry element is not a string");
-      return NULL;
-    }
-    ZITI_NODEJS_LOG(DEBUG, "element_len: %zd", element_len);
-
-    if (element_len > 8*1024) {
-      ZITI_NODEJS_LOG(DEBUG, "skipping header element; length too long");
-      addon_data->httpsReq->on_resp_has_fired = true;
-      break;
-    }
-
-    // Obtain element
-    char* header_element = calloc(1, element_len+2);
-    status = napi_get_value_string_utf8(env, headers_array_element, header_element, element_len+1, &result);
-    if (status != napi_ok) {
-      napi_throw_error(env, "EINVAL", "Failed to obtain element");
-      return NULL;
-    }
-    ZITI_NODEJS_LOG(DEBUG, "header_element: %s", header_element);
+  if (headers_rc > 0) {
+    addon_data->httpsReq->on_resp_has_fired = true;
+  }
 
-    char * header_name = strtok(header_element, ":");
-    if (NULL == header_name) {
-      napi_throw_error(env, "EINVAL", "Failed to split header element");
-      return NULL;
-    }
-    char * header_value = strtok(NULL, ":");
-    if (strlen(header_value) < 1) {
-      napi_throw_error(env, "EINVAL", "Failed to split header element");
-      return NULL;
+  //
+  // Obtain (optional) deadlines and body high water mark
+  //
+  if (argc > 9) {
+    status = napi_typeof(env, args[9], &valuetype);
+    if ((status == napi_ok) && (valuetype == napi_object)) {
+      int64_t connect_ms = 0, ttfb_ms = 0, total_ms = 0;
+      int64_t high_water_mark = 0;
+      if (!get_request_option(env, args[9], "connectTimeoutMs", &connect_ms) ||
+          !get_request_option(env, args[9], "ttfbTimeoutMs", &ttfb_ms) ||
+          !get_request_option(env, args[9], "timeoutMs", &total_ms) ||
+          !get_request_option(env, args[9], "highWaterMark", &high_water_mark)) {
+        free_https_addon_data(addon_data);
+        return NULL;
+      }
+      addon_data->body_high_water_mark = (size_t)high_water_mark;
+
+      uint64_t now = uv_now(thread_loop);
+      addon_data->connect_deadline = (connect_ms > 0) ? (now + connect_ms) : 0;
+      addon_data->ttfb_deadline = (ttfb_ms > 0) ? (now + ttfb_ms) : 0;
+      addon_data->total_deadline = (total_ms > 0) ? (now + total_ms) : 0;
+
+      if ((connect_ms > 0) || (ttfb_ms > 0) || (total_ms > 0)) {
+        addon_data->deadline_timer = calloc(1, sizeof(uv_timer_t));
+        uv_timer_init(thread_loop, addon_data->deadline_timer);
+        addon_data->deadline_timer->data = addon_data;
+        arm_deadline(addon_data);
+      }
     }
-
-    addon_data->header_name[i] = strdup(header_name);
-    addon_data->header_value[i] = strdup(header_value);
-
-    free(header_element);
   }
 
   //
   // Queue the HTTP request.  First thing that happens in the flow is to allocate a client from the pool
+  // (or to wait, without blocking, for one to be released)
   //
-  addon_data->uv_req.data = addon_data;
-  uv_queue_work(thread_loop, &addon_data->uv_req, allocate_client, on_client);
-
-  ZITI_NODEJS_LOG(DEBUG, "uv_queue_work of allocate_client returned req: %p", &(addon_data->uv_req));
+  acquire_client(addon_data);
 
   //
-  // We always return zero.  The real results/status are returned via the multiple callbacks
+  // We return the request handle (the same one later passed to on_req), so that the request can be
+  // cancelled even before it starts.  The real results/status are returned via the multiple callbacks
   //
-  status = napi_create_int64(env, (int64_t)0, &jsRetval);
+  status = create_https_req_handle(env, httpsReq, &jsRetval);
   if (status != napi_ok) {
     napi_throw_error(env, NULL, "Unable to create return value");
     return NULL;
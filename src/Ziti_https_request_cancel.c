@@ -0,0 +1,71 @@
+/*
+Copyright NetFoundry Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ziti-nodejs.h"
+
+
+/**
+ * Cancel an HTTPS request that has not completed yet. Its on_resp callback reports UV_ECANCELED
+ * (unless the response already arrived, in which case the body callback does), and the pool slot it
+ * holds or is waiting for is given up. Cancelling a completed request does nothing.
+ * 
+ * @param {External} [0] req      handle returned by _Ziti_http_request (or passed to on_req)
+ * 
+ * @returns NULL
+ */
+napi_value _Ziti_http_request_cancel(napi_env env, const napi_callback_info info) {
+  napi_status status;
+  size_t argc = 1;
+  napi_value args[1];
+  status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  if (status != napi_ok) {
+    napi_throw_error(env, NULL, "Failed to parse arguments");
+  }
+
+  if (argc != 1) {
+    napi_throw_error(env, "EINVAL", "Invalid argument count");
+    return NULL;
+  }
+
+  // Obtain HttpsReq
+  HttpsReq* httpsReq;
+  if (!get_https_req(env, args[0], &httpsReq)) {
+    return NULL;
+  }
+
+  ZITI_NODEJS_LOG(DEBUG, "httpsReq: %p", httpsReq);
+
+  cancel_https_request(httpsReq->addon_data, UV_ECANCELED);
+
+  return NULL;
+}
+
+
+void expose_ziti_https_request_cancel(napi_env env, napi_value exports) {
+  napi_status status;
+  napi_value fn;
+
+  status = napi_create_function(env, NULL, 0, _Ziti_http_request_cancel, NULL, &fn);
+  if (status != napi_ok) {
+    napi_throw_error(env, NULL, "Unable to wrap native function '_Ziti_http_request_cancel");
+  }
+
+  status = napi_set_named_property(env, exports, "Ziti_http_request_cancel", fn);
+  if (status != napi_ok) {
+    napi_throw_error(env, NULL, "Unable to populate exports for 'Ziti_http_request_cancel");
+  }
+
+}
@@ -19,7 +19,7 @@ limitations under the License.
 
 
 /**
- * This function is responsible for calling the JavaScript on_resp_data callback function 
+ * This function is responsible for calling the JavaScript on_write (or on_drain) callback function
  * that was specified when the Ziti_https_request_data(...) was called from JavaScript.
  */
 static void CallJs_on_req_body(napi_env env, napi_value js_cb, void* context, void* data) {
@@ -28,144 +28,245 @@ static void CallJs_on_req_body(napi_env env, napi_value js_cb, void* context, vo
 
   // This parameter is not used.
   (void) context;
+  (void) js_cb;
 
-  // Retrieve the HttpsRespBodyItem created by the worker thread.
+  // Retrieve the HttpsReqBodyItem created by on_req_body (or by the drain check)
   HttpsReqBodyItem* item = (HttpsReqBodyItem*)data;
 
-  // env and js_cb may both be NULL if Node.js is in its cleanup phase, and
+  // env may be NULL if Node.js is in its cleanup phase, and
   // items are left over from earlier thread-safe calls from the worker thread.
   // When env is NULL, we simply skip over the call into Javascript
   if (env != NULL) {
 
-    napi_value undefined;
+    napi_value undefined, js_item_cb;
+    int rc;
 
     // Retrieve the JavaScript `undefined` value so we can use it as the `this`
     // value of the JavaScript function call.
     napi_get_undefined(env, &undefined);
 
-    // const obj = {}
-    napi_value js_http_item, js_req, js_status, js_body;
-    int rc = napi_create_object(env, &js_http_item);
-    if (rc != napi_ok) {
-      napi_throw_error(env, "EINVAL", "failure to create object");
+    // The C-SDK is done with the chunk, so the caller's Buffer may now be collected
+    if (item->buf_ref != NULL) {
+      napi_delete_reference(env, item->buf_ref);
     }
 
-    // obj.req = req
-    napi_create_int64(env, (int64_t)item->req, &js_req);
-    if (rc != napi_ok) {
-      napi_throw_error(env, "EINVAL", "failure to create resp.req");
-    }
-    rc = napi_set_named_property(env, js_http_item, "req", js_req);
+    rc = napi_get_reference_value(env, item->cb_ref, &js_item_cb);
     if (rc != napi_ok) {
-      napi_throw_error(env, "EINVAL", "failure to set named property req");
+      napi_throw_error(env, "EINVAL", "failure to get callback reference");
     }
-    ZITI_NODEJS_LOG(DEBUG, "js_req: %p", item->req);
+    napi_delete_reference(env, item->cb_ref);
 
-    // obj.code = status
-    rc = napi_create_int32(env, item->status, &js_status);
-    if (rc != napi_ok) {
-      napi_throw_error(env, "EINVAL", "failure to create resp.status");
-    }
-    rc = napi_set_named_property(env, js_http_item, "status", js_status);
-    if (rc != napi_ok) {
-      napi_throw_error(env, "EINVAL", "failure to set named property status");
-    }
-    ZITI_NODEJS_LOG(DEBUG, "status: %zd", item->status);
+    if (item->drain) {
+      rc = napi_call_function(env, undefined, js_item_cb, 0, NULL, NULL);
+      if (rc != napi_ok) {
+        napi_throw_error(env, "EINVAL", "failure to invoke JS callback");
+      }
+    } else {
 
-    // obj.body = body
-    rc = napi_create_int32(env, (int64_t)item->body, &js_body);
-    if (rc != napi_ok) {
-      napi_throw_error(env, "EINVAL", "failure to create resp.body");
-    }
-    rc = napi_set_named_property(env, js_http_item, "body", js_body);
-    if (rc != napi_ok) {
-      napi_throw_error(env, "EINVAL", "failure to set named property body");
-    }
+      // const obj = {}
+      napi_value js_http_item, js_req, js_status, js_body;
+      rc = napi_create_object(env, &js_http_item);
+      if (rc != napi_ok) {
+        napi_throw_error(env, "EINVAL", "failure to create object");
+      }
 
-    // Call the JavaScript function and pass it the HttpsReqBodyItem
-    rc = napi_call_function(
-      env,
-      undefined,
-      js_cb,
-      1,
-      &js_http_item,
-      NULL
-    );
-    if (rc != napi_ok) {
-      napi_throw_error(env, "EINVAL", "failure to invoke JS callback");
-    }
+      // obj.req = req
+      rc = napi_create_int64(env, (int64_t)item->req, &js_req);
+      if (rc != napi_ok) {
+        napi_throw_error(env, "EINVAL", "failure to create resp.req");
+      }
+      rc = napi_set_named_property(env, js_http_item, "req", js_req);
+      if (rc != napi_ok) {
+        napi_throw_error(env, "EINVAL", "failure to set named property req");
+      }
+      ZITI_NODEJS_LOG(DEBUG, "js_req: %p", item->req);
 
-  }
+      // obj.code = status
+      rc = napi_create_int32(env, item->status, &js_status);
+      if (rc != napi_ok) {
+        napi_throw_error(env, "EINVAL", "failure to create resp.status");
+      }
+      rc = napi_set_named_property(env, js_http_item, "status", js_status);
+      if (rc != napi_ok) {
+        napi_throw_error(env, "EINVAL", "failure to set named property status");
+      }
+      ZITI_NODEJS_LOG(DEBUG, "status: %zd", item->status);
 
-  // Free the HttpsReqBodyItem (but NOT item->body / the chunk buffer)
-  // NOTE: We cannot free the chunk here because the C SDK may still be processing
-  // the data through internal buffers/flushes. The chunk will be leaked, but freeing
-  // it here causes use-after-free crashes in link_write_cb during timer-triggered flushes.
-  // TODO: Track chunks and free them when the entire request completes (on EOF/error)
-  if (item != NULL) {
-    // item->body (chunk) intentionally NOT freed - SDK may still reference it
-    free(item);
+      // obj.body = body
+      rc = napi_create_int32(env, (int64_t)item->body, &js_body);
+      if (rc != napi_ok) {
+        napi_throw_error(env, "EINVAL", "failure to create resp.body");
+      }
+      rc = napi_set_named_property(env, js_http_item, "body", js_body);
+      if (rc != napi_ok) {
+        napi_throw_error(env, "EINVAL", "failure to set named property body");
+      }
+
+      // Call the JavaScript function and pass it the HttpsReqBodyItem
+      rc = napi_call_function(
+        env,
+        undefined,
+        js_item_cb,
+        1,
+        &js_http_item,
+        NULL
+      );
+      if (rc != napi_ok) {
+        napi_throw_error(env, "EINVAL", "failure to invoke JS callback");
+      }
+    }
   }
+
+  HttpsAddonData* addon_data = item->addon_data;
+  free(item);
+  release_https_request(addon_data);
 }
 
 
+/**
+ * Drop the request's body dispatcher once the response is complete and no chunks are left.
+ * Called when the request gives up its client.
+ */
+void finish_https_request_body(HttpsAddonData* addon_data) {
+  if ((addon_data->on_req_body == NULL) || (addon_data->body_head != NULL)) {
+    return;
+  }
+  release_dispatcher(addon_data->on_req_body);
+  addon_data->on_req_body = NULL;
+}
 
-// Forward declaration for client release helper
-extern struct ListMap* HttpsClientListMap;
-extern struct ListMap* getInnerListMapValueForKey(struct ListMap* collection, char* key);
 
 /**
+ * A queued body chunk is done with (written, refused, or failed along with the request): take it off the
+ * queue and pass 'status' to its JS callback, which unpins the Buffer.
  *
+ * The callback may run right here and drop the last other reference to the request, so hold one until done.
  */
-void on_req_body(tlsuv_http_req_t *req, char *body, ssize_t status) {
-
-  ZITI_NODEJS_LOG(DEBUG, "status: %zd, body: %p", status, body);
-
-  HttpsAddonData* addon_data = (HttpsAddonData*) req->data;
-  ZITI_NODEJS_LOG(DEBUG, "addon_data is: %p", addon_data);
-
-  HttpsReqBodyItem* item = calloc(1, sizeof(*item));
-  ZITI_NODEJS_LOG(DEBUG, "new HttpsReqBodyItem is: %p", item);
+static void finish_req_body_item(HttpsAddonData* addon_data, HttpsReqBodyItem* item, tlsuv_http_req_t *req, ssize_t status) {
 
-  //  Grab everything off the tlsuv_http_resp_t that we need to eventually pass on to the JS on_resp_body callback.
-  //  If we wait until CallJs_on_resp_body is invoked to do that work, the tlsuv_http_resp_t may have already been free'd by the C-SDK
+  addon_data->refs++;
 
+  HttpsReqBodyItem* prev = NULL;
+  for (HttpsReqBodyItem* i = addon_data->body_head; i != item; i = i->next) {
+    prev = i;
+  }
+  if (prev != NULL) {
+    prev->next = item->next;
+  } else {
+    addon_data->body_head = item->next;
+  }
+  if (addon_data->body_tail == item) {
+    addon_data->body_tail = prev;
+  }
+  item->next = NULL;
+  addon_data->body_queued_bytes -= item->len;
   item->req = req;
-  item->body = (void*)body;
   item->status = status;
 
+  ZITI_NODEJS_LOG(DEBUG, "body_queued_bytes now %zu", addon_data->body_queued_bytes);
+
+  // Like writable 'drain': once a write has said "wait", say when everything queued has been written
+  HttpsReqBodyItem* drain = NULL;
+  if (addon_data->body_need_drain && (addon_data->body_head == NULL)) {
+    addon_data->body_need_drain = false;
+    if (addon_data->on_drain_ref != NULL) {
+      drain = calloc(1, sizeof(*drain));
+      drain->addon_data = addon_data;
+      drain->drain = true;
+      addon_data->refs++;
+      drain->cb_ref = addon_data->on_drain_ref;
+      addon_data->on_drain_ref = NULL;
+    }
+  }
+
   // Decrement pending write count - the write operation is complete
+  bool finished = false;
   HttpsReq* httpsReq = addon_data->httpsReq;
   if (httpsReq != NULL && httpsReq->pending_write_count > 0) {
     httpsReq->pending_write_count--;
     ZITI_NODEJS_LOG(DEBUG, "pending_write_count decremented to %d, response_complete=%d",
                     httpsReq->pending_write_count, httpsReq->response_complete);
 
-    // If response is complete AND all writes are done, release the client
-    if (httpsReq->response_complete && httpsReq->pending_write_count == 0) {
+    // If response is complete AND all writes are done, release the client (one that was never
+    // issued on it is released by start_request)
+    if (httpsReq->response_complete && (httpsReq->pending_write_count == 0) && (httpsReq->req != NULL)) {
       ZITI_NODEJS_LOG(DEBUG, "<--------- releasing client [%p] after final write completed", addon_data->httpsClient);
-      addon_data->httpsClient->active = false;
 
       // NOTE: Do NOT mark client for purge on successful completion
       // Purging is only for error cases
-
-      struct ListMap* clientListMap = getInnerListMapValueForKey(HttpsClientListMap, addon_data->scheme_host_port);
-      if (clientListMap != NULL) {
-        ZITI_NODEJS_LOG(DEBUG, "<-------- returning sem for client: [%p]", addon_data->httpsClient);
-        uv_sem_post(&(clientListMap->sem));
-      }
+      release_https_client(addon_data);
+      finished = true;
     }
   }
 
-  ZITI_NODEJS_LOG(DEBUG, "calling tsfn_on_req_body: %p", addon_data->tsfn_on_req_body);
-
   // Initiate the call into the JavaScript callback.
-  int rc = napi_call_threadsafe_function(
-      addon_data->tsfn_on_req_body,
-      item,
-      napi_tsfn_blocking);
+  napi_status rc = dispatch_to_js(addon_data->on_req_body, item);
   if (rc != napi_ok) {
-    napi_throw_error(addon_data->env, "EINVAL", "failure to invoke JS callback");
+    ZITI_NODEJS_LOG(ERROR, "failure to invoke JS callback");
+  }
+  if (drain != NULL) {
+    rc = dispatch_to_js(addon_data->on_req_body, drain);
+    if (rc != napi_ok) {
+      ZITI_NODEJS_LOG(ERROR, "failure to invoke JS drain callback");
+    }
+  }
+
+  // Only once nothing more goes through the body dispatcher
+  if (finished) {
+    finish_https_request_body(addon_data);
+  }
+
+  release_https_request(addon_data);
+}
+
+
+/**
+ * tlsuv has finished with a body chunk (written, or failed along with the request)
+ */
+void on_req_body(tlsuv_http_req_t *req, char *body, ssize_t status) {
+
+  ZITI_NODEJS_LOG(DEBUG, "status: %zd, body: %p", status, body);
+
+  HttpsAddonData* addon_data = (HttpsAddonData*) req->data;
+  ZITI_NODEJS_LOG(DEBUG, "addon_data is: %p", addon_data);
+
+  // tlsuv completes chunks in the order they were queued, so this is normally the head
+  HttpsReqBodyItem* item = addon_data->body_head;
+  while ((item != NULL) && (item->body != body)) {
+    item = item->next;
+  }
+  if (item == NULL) {
+    ZITI_NODEJS_LOG(ERROR, "completion for unknown body chunk %p", body);
+    return;
+  }
+
+  finish_req_body_item(addon_data, item, req, status);
+}
+
+
+/**
+ * Hand tlsuv the chunks that were queued before the request was issued (see start_request)
+ */
+void flush_https_request_body(HttpsAddonData* addon_data) {
+  tlsuv_http_req_t *r = addon_data->httpsReq->req;
+  HttpsReqBodyItem* item = addon_data->body_head;
+  while (item != NULL) {
+    HttpsReqBodyItem* next = item->next;
+    int rc = tlsuv_http_req_data(r, item->body, item->len, on_req_body);
+    if (rc != 0) {
+      ZITI_NODEJS_LOG(ERROR, "tlsuv_http_req_data failed: %d", rc);
+      finish_req_body_item(addon_data, item, r, rc);
+    }
+    item = next;
+  }
+}
+
+/**
+ * Fail the chunks of a request that will never be issued
+ */
+void fail_https_request_body(HttpsAddonData* addon_data, int code) {
+  while (addon_data->body_head != NULL) {
+    finish_req_body_item(addon_data, addon_data->body_head, NULL, code);
   }
 }
 
@@ -173,21 +274,27 @@ void on_req_body(tlsuv_http_req_t *req, char *body, ssize_t status) {
 
 /**
  * Send Body data over active HTTPS request
- * 
- * @param {string} [0] req
+ *
+ * The Buffer is pinned, not copied, until tlsuv has written it, so it must not be modified until
+ * on_write fires. Returns false once the bytes waiting on tlsuv reach the request's highWaterMark
+ * (like writable.write()); on_drain is then called once they have all been written.
+ *
+ * @param {External} [0] req      handle returned by _Ziti_http_request (or passed to on_req)
  * @param {string} [1] data (we expect a Buffer)
  * @param {func}   [2] JS on_write callback;      This is invoked from 'on_req_body' function above
- * 
- * @returns NULL
+ * @param {func}   [3] JS on_drain callback;      (optional)
+ *
+ * @returns {boolean} whether more data may be written before waiting for on_drain
  */
 napi_value _Ziti_http_request_data(napi_env env, const napi_callback_info info) {
   napi_status status;
-  int rc;
-  size_t argc = 3;
-  napi_value args[3];
+  size_t argc = 4;
+  napi_value args[4];
+  napi_value jsRetval;
   status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   if (status != napi_ok) {
     napi_throw_error(env, NULL, "Failed to parse arguments");
+    return NULL;
   }
 
   if (argc < 3) {
@@ -195,32 +302,25 @@ napi_value _Ziti_http_request_data(napi_env env, const napi_callback_info info)
     return NULL;
   }
 
-  ZITI_NODEJS_LOG(DEBUG, "_Ziti_http_request_data 1");
-
-  // Obtain tlsuv_http_req_t
-  int64_t js_req;
-  status = napi_get_value_int64(env, args[0], &js_req);
-  if (status != napi_ok) {
-    napi_throw_error(env, NULL, "Failed to get Req");
+  // Obtain HttpsReq
+  HttpsReq* httpsReq;
+  if (!get_https_req(env, args[0], &httpsReq)) {
+    return NULL;
   }
-  ZITI_NODEJS_LOG(DEBUG, "_Ziti_http_request_data 2");
-  ZITI_NODEJS_LOG(DEBUG, "js_req: %p", js_req);
-  // tlsuv_http_req_t *r = (tlsuv_http_req_t*)js_req;
-  HttpsReq* httpsReq = (HttpsReq*)js_req;
   ZITI_NODEJS_LOG(DEBUG, "httpsReq: %p", httpsReq);
   tlsuv_http_req_t *r = httpsReq->req;
 
-  ZITI_NODEJS_LOG(DEBUG, "_Ziti_http_request_data 3");
-
   ZITI_NODEJS_LOG(DEBUG, "req: %p", r);
 
   HttpsAddonData* addon_data = httpsReq->addon_data;
   ZITI_NODEJS_LOG(DEBUG, "addon_data is: %p", addon_data);
 
-  // If some kind of Ziti error previously occured on this request, then short-circuit now
-  if (httpsReq->on_resp_has_fired && (httpsReq->respCode < 0)) {
+  // If some kind of Ziti error previously occured on this request, or it is already complete, then
+  // short-circuit now (there is nothing to wait for, so don't tell the caller to wait for a drain)
+  if (httpsReq->response_complete || (httpsReq->on_resp_has_fired && (httpsReq->respCode < 0))) {
     ZITI_NODEJS_LOG(DEBUG, "aborting due to previous error: %d", httpsReq->respCode);
-    return NULL;
+    napi_get_boolean(env, true, &jsRetval);
+    return jsRetval;
   }
 
   // Obtain data to write (we expect a Buffer)
@@ -229,64 +329,95 @@ napi_value _Ziti_http_request_data(napi_env env, const napi_callback_info info)
   status = napi_get_buffer_info(env, args[1], &buffer, &bufferLength);
   if (status != napi_ok) {
     napi_throw_error(env, NULL, "Failed to get Buffer info");
+    return NULL;
   }
   ZITI_NODEJS_LOG(DEBUG, "bufferLength: %zd", bufferLength);
 
-  // Since the underlying Buffer's lifetime is not guaranteed if it's managed by the VM, we will copy the chunk into our heap
-  void* chunk = calloc(1, bufferLength + 1);
-  memcpy(chunk, buffer, bufferLength);
+  if (addon_data->on_req_body == NULL) {
+    // No JS function is bound here; CallJs_on_req_body takes it from each HttpsReqBodyItem.
+    // The request itself keeps the loop alive while chunks are outstanding.
+    status = create_dispatcher(env, NULL, "N-API on_req_body", CallJs_on_req_body, &addon_data->on_req_body);
+    if (status != napi_ok) {
+      napi_throw_error(env, "EINVAL", "Failed to create dispatcher");
+      return NULL;
+    }
+    napi_unref_threadsafe_function(env, addon_data->on_req_body->tsfn);
+  }
 
-  // Track the chunk so it can be freed when the request completes
-  // (we can't free it in on_req_body because the C SDK may still be processing it)
-  if (addon_data->pending_chunk_count < MAX_PENDING_CHUNKS) {
-    addon_data->pending_chunks[addon_data->pending_chunk_count++] = chunk;
-    ZITI_NODEJS_LOG(DEBUG, "tracked chunk %p at index %d", chunk, addon_data->pending_chunk_count - 1);
-  } else {
-    ZITI_NODEJS_LOG(ERROR, "too many pending chunks, chunk %p will be leaked", chunk);
+  HttpsReqBodyItem* item = calloc(1, sizeof(*item));
+  item->addon_data = addon_data;
+  item->body = buffer;
+  item->len = bufferLength;
+
+  // Pin the Buffer so the VM can't collect it while the C-SDK still references its contents
+  status = napi_create_reference(env, args[1], 1, &item->buf_ref);
+  if (status == napi_ok) {
+    status = napi_create_reference(env, args[2], 1, &item->cb_ref);
+  }
+  if (status != napi_ok) {
+    if (item->buf_ref != NULL) {
+      napi_delete_reference(env, item->buf_ref);
+    }
+    free(item);
+    napi_throw_error(env, NULL, "Failed to napi_create_reference");
+    return NULL;
   }
 
-  // Obtain ptr to JS 'on_write' callback function
-  napi_value js_write_cb = args[2];
-  napi_value work_name;
+  // Obtain (optional) ptr to JS 'on_drain' callback function; the latest one given is the one called
+  if (argc > 3) {
+    napi_valuetype valuetype;
+    status = napi_typeof(env, args[3], &valuetype);
+    if ((status == napi_ok) && (valuetype == napi_function)) {
+      if (addon_data->on_drain_ref != NULL) {
+        napi_delete_reference(env, addon_data->on_drain_ref);
+      }
+      napi_create_reference(env, args[3], 1, &addon_data->on_drain_ref);
+    }
+  }
 
-  // Create a string to describe this asynchronous operation.
-  status = napi_create_string_utf8(
-    env,
-    "N-API on_write",
-    NAPI_AUTO_LENGTH,
-    &work_name);
-  if (status != napi_ok) {
-    napi_throw_error(env, NULL, "Failed to napi_create_string_utf8");
+  // Queue the chunk; it keeps the request allocated until its callback has run
+  addon_data->refs++;
+  if (addon_data->body_tail != NULL) {
+    addon_data->body_tail->next = item;
+  } else {
+    addon_data->body_head = item;
   }
+  addon_data->body_tail = item;
+  addon_data->body_queued_bytes += bufferLength;
 
-  // Convert the callback retrieved from JavaScript into a thread-safe function (tsfn) 
-  // which we can call from a worker thread.
-  rc = napi_create_threadsafe_function(
-      env,
-      js_write_cb,
-      NULL,
-      work_name,
-      0,
-      1,
-      NULL,
-      NULL,
-      NULL,
-      CallJs_on_req_body,
-      &(addon_data->tsfn_on_req_body)
-  );
-  if (rc != napi_ok) {
-    napi_throw_error(env, "EINVAL", "Failed to create threadsafe_function");
+  size_t high_water_mark = addon_data->body_high_water_mark;
+  if (high_water_mark == 0) {
+    high_water_mark = ZITI_NODEJS_HTTPS_BODY_HIGH_WATER_MARK;
+  }
+  bool more = (addon_data->body_queued_bytes < high_water_mark);
+  if (!more) {
+    addon_data->body_need_drain = true;
   }
-  ZITI_NODEJS_LOG(DEBUG, "napi_create_threadsafe_function addon_data->tsfn_on_req_body() : %p", addon_data->tsfn_on_req_body);
+  ZITI_NODEJS_LOG(DEBUG, "body_queued_bytes: %zu, high_water_mark: %zu", addon_data->body_queued_bytes, high_water_mark);
 
   // Track pending write to prevent client reuse while write is in progress
   httpsReq->pending_write_count++;
   ZITI_NODEJS_LOG(DEBUG, "pending_write_count incremented to %d", httpsReq->pending_write_count);
 
+  // Not issued on a client yet: start_request hands the queued chunks to tlsuv
+  if (r == NULL) {
+    ZITI_NODEJS_LOG(DEBUG, "request not started yet, holding chunk");
+    napi_get_boolean(env, more, &jsRetval);
+    return jsRetval;
+  }
+
   // Now, call the C-SDK to actually write the data over to the service
-  tlsuv_http_req_data(r, chunk, bufferLength, on_req_body );
+  enter_native_call();
+  int rc = tlsuv_http_req_data(r, buffer, bufferLength, on_req_body );
+  leave_native_call();
+  if (rc != 0) {
+    // Refused outright, so on_req_body will never see it
+    ZITI_NODEJS_LOG(ERROR, "tlsuv_http_req_data failed: %d", rc);
+    finish_req_body_item(addon_data, item, r, rc);
+  }
 
-  return NULL;
+  napi_get_boolean(env, more, &jsRetval);
+  return jsRetval;
 }
 
 
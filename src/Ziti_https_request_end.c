@@ -19,9 +19,10 @@ limitations under the License.
 
 
 /**
- * Indicate that an active HTTPS request is now complete
+ * Indicate that an active HTTPS request is now complete. If it has not been issued on a client yet,
+ * it is ended once the body written so far has been handed to tlsuv.
  * 
- * @param {string} [0] req
+ * @param {External} [0] req      handle returned by _Ziti_http_request (or passed to on_req)
  * 
  * @returns NULL
  */
@@ -39,21 +40,22 @@ napi_value _Ziti_http_request_end(napi_env env, const napi_callback_info info) {
     return NULL;
   }
 
-  // Obtain tlsuv_http_req_t
-  int64_t js_req;
-  status = napi_get_value_int64(env, args[0], &js_req);
-  if (status != napi_ok) {
-    napi_throw_error(env, NULL, "Failed to get Req");
+  // Obtain HttpsReq
+  HttpsReq* httpsReq;
+  if (!get_https_req(env, args[0], &httpsReq)) {
+    return NULL;
   }
-  HttpsReq* httpsReq = (HttpsReq*)js_req;
   tlsuv_http_req_t *r = httpsReq->req;
 
   ZITI_NODEJS_LOG(DEBUG, "req: %p", r);
 
   // TEMP hack to work around an issue still being debugged
   ZITI_NODEJS_LOG(DEBUG, "httpsReq->on_resp_has_fired: %o", httpsReq->on_resp_has_fired);
-  if (httpsReq->on_resp_has_fired) {
+  if (httpsReq->on_resp_has_fired || httpsReq->response_complete) {
     ZITI_NODEJS_LOG(DEBUG, "seems as though on_resp has previously fired... skipping call to tlsuv_http_req_end");
+  } else if (r == NULL) {
+    // Not issued on a client yet; start_request ends it after the queued body
+    httpsReq->end_pending = true;
   } else {
     tlsuv_http_req_end(r);
   }
@@ -69,6 +69,10 @@ static void on_z_connect(ziti_connection conn, int status) {
 
 static napi_value z_connect(napi_env env, napi_callback_info info) {
 
+    if (reject_on_net_thread(env, "ziti_connect")) {
+        return NULL;
+    }
+
     size_t argc = 4;
     napi_value args[4] = {};
     NAPI_CHECK(env, "parse args", napi_get_cb_info(env, info, &argc, args, NULL, NULL));
@@ -145,7 +149,138 @@ static napi_value z_connect(napi_env env, napi_callback_info info) {
     return undefined;
 }
 
+// Resolved (protocol, host, port) -> dial info, including addresses no service intercepts.
+// LRU-bounded; entries are dropped on the service events that could change them (see invalidate_service_cache),
+// and all of them when the context goes away (see clear_service_cache).
+// Only used on the JS thread: get_ziti_service is rejected when the network thread runs the SDK,
+// so the cache stays empty then.
+#define ZITI_NODEJS_SERVICE_CACHE_SIZE 1024
+#define SERVICE_CACHE_BUCKETS (2 * ZITI_NODEJS_SERVICE_CACHE_SIZE)
+
+typedef struct ServiceCacheEntry {
+    struct ServiceCacheEntry *hash_next;
+    struct ServiceCacheEntry *lru_prev;     // towards the most recently used
+    struct ServiceCacheEntry *lru_next;
+    uint32_t hash;
+    ziti_protocol proto;
+    int port;
+    char *host;
+    char *service;                          // NULL when no service intercepts the address
+    napi_ref result;                        // the frozen { service, identity, data } handed to JS
+} ServiceCacheEntry;
+
+static ServiceCacheEntry *cache_buckets[SERVICE_CACHE_BUCKETS];
+static ServiceCacheEntry *lru_head = NULL;
+static ServiceCacheEntry *lru_tail = NULL;
+static size_t cache_count = 0;
+static napi_env cache_env = NULL;
+
+// FNV-1a over host, then protocol and port
+static uint32_t hash_addr(ziti_protocol proto, const char *host, int port) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)host; *p != '\0'; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    hash ^= (uint32_t)proto;
+    hash *= 16777619u;
+    hash ^= (uint32_t)port;
+    hash *= 16777619u;
+    return hash;
+}
+
+static void lru_unlink(ServiceCacheEntry *e) {
+    if (e->lru_prev) e->lru_prev->lru_next = e->lru_next; else lru_head = e->lru_next;
+    if (e->lru_next) e->lru_next->lru_prev = e->lru_prev; else lru_tail = e->lru_prev;
+    e->lru_prev = e->lru_next = NULL;
+}
+
+static void lru_push_front(ServiceCacheEntry *e) {
+    e->lru_prev = NULL;
+    e->lru_next = lru_head;
+    if (lru_head) lru_head->lru_prev = e; else lru_tail = e;
+    lru_head = e;
+}
+
+static void drop_cache_entry(ServiceCacheEntry *e) {
+    ServiceCacheEntry **link = &cache_buckets[e->hash & (SERVICE_CACHE_BUCKETS - 1)];
+    while (*link != e) {
+        link = &(*link)->hash_next;
+    }
+    *link = e->hash_next;
+    lru_unlink(e);
+    cache_count--;
+
+    if (e->result) {
+        napi_delete_reference(cache_env, e->result);
+    }
+    free(e->host);
+    free(e->service);
+    free(e);
+}
+
+static ServiceCacheEntry *find_cache_entry(ziti_protocol proto, const char *host, int port, uint32_t hash) {
+    for (ServiceCacheEntry *e = cache_buckets[hash & (SERVICE_CACHE_BUCKETS - 1)]; e; e = e->hash_next) {
+        if (e->hash == hash && e->proto == proto && e->port == port && strcmp(e->host, host) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static ServiceCacheEntry *add_cache_entry(napi_env env, ziti_protocol proto, const char *host, int port, uint32_t hash) {
+    if (cache_count >= ZITI_NODEJS_SERVICE_CACHE_SIZE) {
+        drop_cache_entry(lru_tail);
+    }
+    cache_env = env;
+
+    ServiceCacheEntry *e = calloc(1, sizeof(*e));
+    e->hash = hash;
+    e->proto = proto;
+    e->port = port;
+    e->host = strdup(host);
+
+    size_t slot = hash & (SERVICE_CACHE_BUCKETS - 1);
+    e->hash_next = cache_buckets[slot];
+    cache_buckets[slot] = e;
+    lru_push_front(e);
+    cache_count++;
+    return e;
+}
+
+/**
+ * Drop the cached resolutions a service event may have changed: those that resolved to 'service_name'
+ * (when given), and, if 'negatives', those that no service intercepted.
+ */
+void invalidate_service_cache(const char *service_name, bool negatives) {
+    ServiceCacheEntry *e = lru_head;
+    while (e != NULL) {
+        ServiceCacheEntry *next = e->lru_next;
+        if (e->service == NULL ? negatives : (service_name != NULL && strcmp(e->service, service_name) == 0)) {
+            drop_cache_entry(e);
+        }
+        e = next;
+    }
+}
+
+/**
+ * Drop every cached resolution: a new service may intercept an address more specifically than the one it
+ * resolved to, and none of them hold once the context is shut down or replaced
+ */
+void clear_service_cache(void) {
+    while (lru_head != NULL) {
+        drop_cache_entry(lru_head);
+    }
+}
+
+/**
+ * The { service, identity, data } to dial for (protocol, host, port), or undefined when no service intercepts it
+ */
 static napi_value z_get_service_for_addr(napi_env env, napi_callback_info info) {
+    if (reject_on_net_thread(env, "get_ziti_service")) {
+        return NULL;
+    }
+
     size_t argc = 3;
     napi_value args[3] = {};
     NAPI_CHECK(env, "parse args", napi_get_cb_info(env, info, &argc, args, NULL, NULL));
@@ -163,11 +298,41 @@ static napi_value z_get_service_for_addr(napi_env env, napi_callback_info info)
 
     ziti_protocol zitiProtocol = ziti_protocols.value_of(proto);
 
+    uint32_t hash = hash_addr(zitiProtocol, host, port);
+    ServiceCacheEntry *e = find_cache_entry(zitiProtocol, host, port, hash);
+    if (e != NULL) {
+        lru_unlink(e);
+        lru_push_front(e);
+        if (e->result == NULL) {
+            NAPI_UNDEFINED(env, undefined);
+            return undefined;
+        }
+        napi_value cached;
+        NAPI_CHECK(env, "get cached service", napi_get_reference_value(env, e->result, &cached));
+        return cached;
+    }
+
     ziti_dial_opts dialOpts;
     const ziti_service *srv = ziti_dial_opts_for_addr(&dialOpts, ztx, zitiProtocol, host, port, NULL, 0);
+    if (srv == NULL && services_provisional()) {
+        // Until the controller's first service event, answer from the services restored from the
+        // service cache: the name only, and nothing is cached, since the answer may not hold
+        const char *cached_service = find_service_for_hostname(host, port);
+        if (cached_service == NULL) {
+            NAPI_UNDEFINED(env, undefined);
+            return undefined;
+        }
+        napi_value result;
+        napi_create_object(env, &result);
+        napi_value serviceName;
+        NAPI_CHECK(env, "create service name", napi_create_string_utf8(env, cached_service, NAPI_AUTO_LENGTH, &serviceName));
+        napi_set_named_property(env, result, "service", serviceName);
+        return result;
+    }
     if (srv == NULL) {
-        napi_throw_error(env, NULL, ziti_errorstr(ZITI_SERVICE_UNAVAILABLE));
-        return NULL;
+        add_cache_entry(env, zitiProtocol, host, port, hash);
+        NAPI_UNDEFINED(env, undefined);
+        return undefined;
     }
 
     napi_value result;
@@ -190,6 +355,13 @@ static napi_value z_get_service_for_addr(napi_env env, napi_callback_info info)
     free(dialOpts.app_data);
     free((void*)dialOpts.identity);
 
+    // Every later lookup of this address hands out the same object, so it must not change
+    if (napi_object_freeze(env, result) == napi_ok) {
+        e = add_cache_entry(env, zitiProtocol, host, port, hash);
+        e->service = strdup(srv->name);
+        napi_create_reference(env, result, 1, &e->result);
+    }
+
     return result;
 }
 
@@ -22,9 +22,6 @@ uv_loop_t *thread_loop;
 
 napi_value Init(napi_env env, napi_value exports) {
 
-  if (uv_mutex_init(&client_pool_lock))
-    abort();
-
   napi_status status = napi_get_uv_event_loop(env, &thread_loop);
   if (status != napi_ok) {
     char errmsg[128];
@@ -52,6 +49,7 @@ napi_value Init(napi_env env, napi_value exports) {
 
   // Expose some Ziti SDK functions to JavaScript
   expose_ziti_close(env, exports);
+  expose_ziti_close_write(env, exports);
   expose_ziti_dial(env, exports);
   expose_ziti_enroll(env, exports);
   expose_ziti_sdk_version(env, exports);
@@ -59,13 +57,28 @@ napi_value Init(napi_env env, napi_value exports) {
   expose_ziti_init_external_auth(env, exports);
   expose_ziti_listen(env, exports);
   expose_ziti_service_available(env, exports);
+  expose_ziti_service_available_sync(env, exports);
+  expose_ziti_services_available_sync(env, exports);
+  expose_ziti_services_provisional(env, exports);
   expose_ziti_services_refresh(env, exports);
+  expose_ziti_set_service_event_callback(env, exports);
   expose_ziti_shutdown(env, exports);
+  expose_ziti_context_status(env, exports);
   expose_ziti_write(env, exports);
+  expose_ziti_writev(env, exports);
+  expose_ziti_cork(env, exports);
+  expose_ziti_uncork(env, exports);
+  expose_ziti_set_coalesce_delay(env, exports);
+  expose_ziti_pause(env, exports);
+  expose_ziti_resume(env, exports);
+  expose_ziti_set_high_water_mark(env, exports);
 
   expose_ziti_https_request(env, exports);
   expose_ziti_https_request_data(env, exports);
   expose_ziti_https_request_end(env, exports);
+  expose_ziti_https_request_cancel(env, exports);
+  expose_ziti_set_https_pool_config(env, exports);
+  expose_ziti_https_pool_stats(env, exports);
 
   expose_ziti_websocket_connect(env, exports);
   expose_ziti_websocket_write(env, exports);
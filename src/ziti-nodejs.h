@@ -83,17 +83,35 @@ UV_EXTERN int uv_gettimeofday(uv_timeval64_t* tv);
 
 
 
+// Pointer-sized atomics for the lock-free queues shared with the network thread, and 32-bit ones for
+// status words it publishes
+#if defined(_MSC_VER)
+#  define ZITI_ATOMIC_LOAD_INT32(p)           InterlockedCompareExchange((LONG volatile *)(p), 0, 0)
+#  define ZITI_ATOMIC_STORE_INT32(p, v)       InterlockedExchange((LONG volatile *)(p), (v))
+#  define ZITI_ATOMIC_LOAD_PTR(p)             InterlockedCompareExchangePointer((PVOID volatile *)(p), NULL, NULL)
+#  define ZITI_ATOMIC_XCHG_PTR(p, v)          InterlockedExchangePointer((PVOID volatile *)(p), (v))
+#  define ZITI_ATOMIC_CAS_PTR(p, expected, v) (InterlockedCompareExchangePointer((PVOID volatile *)(p), (v), (expected)) == (expected))
+#else
+#  define ZITI_ATOMIC_LOAD_INT32(p)           __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#  define ZITI_ATOMIC_STORE_INT32(p, v)       __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#  define ZITI_ATOMIC_LOAD_PTR(p)             __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#  define ZITI_ATOMIC_XCHG_PTR(p, v)          __atomic_exchange_n((p), (v), __ATOMIC_ACQ_REL)
+#  define ZITI_ATOMIC_CAS_PTR(p, expected, v) __sync_bool_compare_and_swap((p), (expected), (v))
+#endif
+
 /**
- * 
+ * Hands native events to a JS callback: directly when raised on the JS thread (see dispatch_to_js),
+ * through its threadsafe function otherwise.
  */
 typedef struct {
-  bool isWebsocket;
-  napi_async_work work;
-  napi_threadsafe_function tsfn_on_connect;
-  napi_threadsafe_function tsfn_on_data;
-  napi_threadsafe_function tsfn_on_write;
-  napi_threadsafe_function tsfn_on_service_available;
-} ConnAddonData;
+  napi_env env;
+  napi_ref js_cb;                             // NULL when the JS function travels with each item
+  napi_ref resource;
+  napi_async_context async_context;
+  napi_threadsafe_function tsfn;
+  napi_threadsafe_function_call_js call_js;
+  uv_thread_t thread;                         // the JS thread that owns env
+} Dispatcher;
 
 /**
  * 
@@ -103,12 +121,66 @@ typedef struct {
   int64_t js_arb_data;
   ziti_connection server;
   napi_async_work work;
-  napi_threadsafe_function tsfn_on_listen;
-  napi_threadsafe_function tsfn_on_listen_client;
-  napi_threadsafe_function tsfn_on_listen_client_connect;
-  napi_threadsafe_function tsfn_on_listen_client_data;
+  Dispatcher *on_listen;
+  Dispatcher *on_listen_client;
+  Dispatcher *on_listen_client_connect;
+  Dispatcher *on_listen_client_data;
+  Dispatcher *on_write;                     // write-completion dispatcher shared by all accepted clients
 } ListenAddonData;
 
+struct WriteItem;
+
+// An inbound chunk waiting (on its connection's stack) to be passed into the JavaScript on_data callback
+typedef struct OnDataItem {
+  struct OnDataItem *next;
+  unsigned char *buf;   // heap copy of the inbound data; ownership moves to the JS Buffer
+  size_t len;
+} OnDataItem;
+
+// How a batch of queued inbound chunks is handed to the JavaScript on_data callback
+typedef enum {
+  DATA_MODE_CONCAT,     // one Buffer holding every chunk (the default)
+  DATA_MODE_ARRAY       // an Array with one Buffer per chunk
+} DataMode;
+
+/**
+ * 
+ */
+typedef struct {
+  bool isWebsocket;
+  napi_async_work work;
+  Dispatcher *on_connect;
+  Dispatcher *on_data;
+  Dispatcher *on_write;                     // created once per connection; the per-write JS callback travels in the WriteItem
+  ListenAddonData *listener;                // set only on clients accepted via ziti_listen
+  int pending_writes;                       // writes handed to the C-SDK whose on_write has not fired yet
+  size_t undelivered_bytes;                 // inbound bytes queued for JS whose callback has not run yet
+  size_t high_water_mark;                   // inbound data is refused while undelivered_bytes is at or above this
+  bool paused;                              // set by ziti_pause; inbound data stays with the C-SDK until ziti_resume
+  bool refused;                             // inbound data was refused, and the C-SDK must be told when it can flush again
+  ziti_connection conn;                     // the connection this belongs to (for that flush)
+  OnDataItem *inbound;                      // chunks received since the last on_data delivery, newest first;
+                                            // pushed by on_data, taken whole by CallJs_on_data (lock-free)
+  DataMode data_mode;
+  int cork_count;                           // ziti_cork calls not yet matched by ziti_uncork
+  uint64_t coalesce_delay_us;               // 0: writes go out at once; otherwise they are held this long to coalesce
+  uv_timer_t *coalesce_timer;               // created on first use, on the loop that runs the C-SDK
+  struct WriteItem *corked_head;            // writes held back by cork or coalescing, oldest first
+  struct WriteItem *corked_tail;
+  size_t corked_bytes;
+  bool closed;
+} ConnAddonData;
+
+// Default per-connection limit on inbound bytes queued for JS (see ziti_set_high_water_mark)
+#define ZITI_NODEJS_DEFAULT_HIGH_WATER_MARK (1024 * 1024)
+
+// Request headers taken from a JS array of "name:value" strings, packed into a single allocation
+// sized to fit them: "name\0value\0name\0value\0..." (see capture_request_headers)
+typedef struct RequestHeaders {
+  uint32_t count;
+  char* buf;
+} RequestHeaders;
+
 /**
  * 
  */
@@ -120,48 +192,69 @@ typedef struct {
   tlsuv_src_t ziti_src;
   tlsuv_websocket_t ws;
   uv_connect_t req;
-  uint32_t headers_array_length;
-  char* header_name[100];
-  char* header_value[100];
+  RequestHeaders headers;
   char* service;
 } WSAddonData;
 
 
-// Constants for client pool management
-enum { listMapCapacity = 50 };
-enum { perKeyListMapCapacity = 25 };
+// Defaults for each scheme_host_port's client pool (see ziti_set_https_pool_config)
+#define ZITI_NODEJS_HTTPS_POOL_MIN_IDLE         0
+#define ZITI_NODEJS_HTTPS_POOL_MAX_CLIENTS      25
+#define ZITI_NODEJS_HTTPS_POOL_IDLE_TIMEOUT_MS  30000
 
-struct key_value {
-    char* key;
-    void* value;
-};
+// Config type of zrok-shared services
+#define ZROK_PROXY_CFG_V1 "zrok.proxy.v1"
 
-struct ListMap {
-  struct   key_value kvPairs[listMapCapacity];
-  size_t   count;
-  uv_sem_t sem;
-};
+// What is known about a service, copied out of a service event (see copy_service_info)
+typedef struct ServiceInfo {
+  char* name;
+  char* id;
+  int perm_flags;                       // ZITI_CAN_DIAL | ZITI_CAN_BIND
+  char* intercept_cfg;                  // raw JSON of its intercept.v1, ziti-tunneler-client.v1 and zrok.proxy.v1 configs,
+  char* client_cfg;                     //   NULL for those it does not have
+  char* zrok_cfg;
+} ServiceInfo;
+
+// One hostname, and interval of ports, a service is reachable at (see track_service_to_hostname)
+typedef struct ServiceHostnameEntry {
+  char* hostname;
+  int low_port;
+  int high_port;
+} ServiceHostnameEntry;
 
 // An item that will be passed into the JavaScript on_resp callback
+// The status text and headers live in one allocation, the arena: "status\0name\0value\0name\0value\0..."
 typedef struct HttpsRespItem {
+  struct HttpsAddonData *addon_data;    // referenced until the item has been delivered
   tlsuv_http_req_t *req;
   int code;
-  char* status;
-  tlsuv_http_hdr *headers;
+  char* status;           // start of the arena
+  uint32_t header_count;  // name/value pairs following the status in the arena
 } HttpsRespItem;
 
 // An item that will be passed into the JavaScript on_resp_body callback
 typedef struct HttpsRespBodyItem {
+  struct HttpsAddonData *addon_data;    // referenced until the item has been delivered
   tlsuv_http_req_t *req;
   const void *body;
   ssize_t len;
 } HttpsRespBodyItem;
 
-// An item that will be passed into the JavaScript on_req_body callback
+struct HttpsAddonData;
+
+// A request body chunk: the caller's Buffer, pinned until tlsuv has written it, then passed into the
+// JavaScript on_req_body callback. A drain item carries the on_drain callback instead.
+// Each holds a reference on its request until it has been delivered.
 typedef struct HttpsReqBodyItem {
+  struct HttpsReqBodyItem *next;
+  struct HttpsAddonData *addon_data;
   tlsuv_http_req_t *req;
   const void *body;
+  size_t len;
   ssize_t status;
+  bool drain;
+  napi_ref buf_ref;
+  napi_ref cb_ref;
 } HttpsReqBodyItem;
 
 
@@ -175,42 +268,88 @@ typedef struct HttpsReq {
   // Track pending writes to prevent client reuse while writes are in progress
   int pending_write_count;
   bool response_complete;
+  bool end_pending;             // httpRequestEnd was called before the request was issued on a client
 } HttpsReq;
 
-typedef struct {
-  char* scheme_host_port;
+typedef struct HttpsClientPool HttpsClientPool;
+
+typedef struct HttpsClient {
+  char* scheme_host_port;               // the pool's key (not owned)
   tlsuv_http_t client;
   tlsuv_src_t ziti_src;
   bool active;
   bool purge;
+  HttpsClientPool* pool;
+  struct HttpsClient* next_idle;        // next client on the pool's idle list
+  uint64_t idle_since;                  // loop time (ms) the client went idle
+  bool draining;                        // closed, and waiting for tlsuv to finish with it before it is freed
 } HttpsClient;
 
-// Maximum number of pending write chunks per request
-#define MAX_PENDING_CHUNKS 64
+typedef struct HttpsPoolConfig {
+  uint32_t min_idle;                    // idle clients that are never evicted
+  uint32_t max_clients;                 // requests beyond this many wait for a client
+  uint64_t idle_timeout_ms;             // idle clients beyond min_idle are closed after this long; 0 never
+} HttpsPoolConfig;
+
+// The HTTPS clients for one scheme_host_port (see ziti_https_pool.c).
+// Clients are created on demand, up to config.max_clients, and closed after sitting idle.
+struct HttpsClientPool {
+  char* scheme_host_port;               // interned key, shared by the pool's clients
+  uint32_t hash;
+  HttpsPoolConfig config;
+  size_t client_count;                  // active plus idle
+  size_t idle_count;
+  HttpsClient* idle;                    // clients free for the next request, most recently used first
+  uv_timer_t* idle_timer;
+  HttpsAddonData* waiters_head;         // requests waiting for a client, oldest first
+  HttpsAddonData* waiters_tail;
+};
+
+// Default number of request body bytes that may be waiting on tlsuv before Ziti_http_request_data returns false
+#define ZITI_NODEJS_HTTPS_BODY_HIGH_WATER_MARK (64 * 1024)
+
+// A request's HttpsAddonData, HttpsReq, strings and HttpsRespItem are bump-allocated from a chain of these
+// (see https_arena_alloc in Ziti_https_request.c). The first block holds the HttpsAddonData itself.
+#define ZITI_NODEJS_HTTPS_ARENA_BLOCK_SIZE 4096
+
+typedef struct HttpsArenaBlock {
+  struct HttpsArenaBlock* next;
+  size_t size;
+  size_t used;
+} HttpsArenaBlock;
 
 struct HttpsAddonData {
+  HttpsArenaBlock* arena;       // first block of this request's arena; freeing the arena frees this struct too
+  uint32_t refs;                // one per JS handle to the request and per item queued for JS, plus the request's
+                                //   own until tlsuv is done with it (its final on_resp/on_resp_body)
   napi_env env;
   tlsuv_http_t client;
   tlsuv_http_req_t ziti_src;
   napi_threadsafe_function tsfn_on_req;
   napi_threadsafe_function tsfn_on_resp;
   napi_threadsafe_function tsfn_on_resp_body;
-  napi_threadsafe_function tsfn_on_req_body;
   HttpsRespItem* item;
   HttpsReq* httpsReq;
-  uv_work_t uv_req;
+  HttpsAddonData* next_waiter;  // next request in its pool's waiter queue, or in the queue of requests about to start
+  uv_timer_t* deadline_timer;   // armed for the earliest deadline that still applies (see arm_deadline)
+  uint64_t connect_deadline;    // loop times (ms) by which the request must have a client, response headers,
+  uint64_t ttfb_deadline;       //   and be complete; 0 for none
+  uint64_t total_deadline;
+  int cancel_code;              // UV_ETIMEDOUT or UV_ECANCELED, once the request has been cancelled
   bool haveURL;
   char* service;
   char* scheme_host_port;
   char* method;
   char* path;
-  uint32_t headers_array_length;
-  char* header_name[100];
-  char* header_value[100];
+  RequestHeaders headers;
   HttpsClient* httpsClient;
-  // Track pending write chunks so they can be freed when request completes
-  void* pending_chunks[MAX_PENDING_CHUNKS];
-  uint32_t pending_chunk_count;
+  Dispatcher* on_req_body;              // chunk completions and drain; created by the first body write
+  HttpsReqBodyItem* body_head;          // chunks tlsuv has not finished writing, oldest first
+  HttpsReqBodyItem* body_tail;
+  size_t body_queued_bytes;
+  size_t body_high_water_mark;
+  bool body_need_drain;                 // a write has returned false, so on_drain is owed once the queue empties
+  napi_ref on_drain_ref;
 } ;
 
 
@@ -221,11 +360,10 @@ extern "C" {
 extern ziti_context ztx;
 extern uv_loop_t *thread_loop;
 
-extern uv_mutex_t client_pool_lock;
-
 // extern void set_signal_handler();
 
 extern void expose_ziti_close(napi_env env, napi_value exports);
+extern void expose_ziti_close_write(napi_env env, napi_value exports);
 extern void expose_ziti_dial(napi_env env, napi_value exports);
 extern void expose_ziti_enroll(napi_env env, napi_value exports);
 extern void expose_ziti_sdk_version(napi_env env, napi_value exports);
@@ -239,20 +377,87 @@ extern void expose_ziti_set_logger(napi_env env, napi_value exports);
 extern void expose_ziti_connect(napi_env env, napi_value exports);
 extern void expose_get_ziti_service(napi_env env, napi_value exports);
 extern void expose_ziti_shutdown(napi_env env, napi_value exports);
+extern void expose_ziti_context_status(napi_env env, napi_value exports);
 extern void expose_ziti_write(napi_env env, napi_value exports);
+extern void expose_ziti_writev(napi_env env, napi_value exports);
+extern void expose_ziti_cork(napi_env env, napi_value exports);
+extern void expose_ziti_uncork(napi_env env, napi_value exports);
+extern void expose_ziti_set_coalesce_delay(napi_env env, napi_value exports);
 extern void expose_ziti_https_request(napi_env env, napi_value exports);
 extern void expose_ziti_https_request_data(napi_env env, napi_value exports);
 extern void expose_ziti_https_request_end(napi_env env, napi_value exports);
+extern void expose_ziti_https_request_cancel(napi_env env, napi_value exports);
+extern void expose_ziti_set_https_pool_config(napi_env env, napi_value exports);
 extern void expose_ziti_websocket_connect(napi_env env, napi_value exports);
 extern void expose_ziti_websocket_write(napi_env env, napi_value exports);
 extern void expose_ziti_websocket_close(napi_env env, napi_value exports);
 extern void expose_ziti_websocket_ping(napi_env env, napi_value exports);
 extern void expose_ziti_ext_auth_token(napi_env env, napi_value exports);
+extern void expose_ziti_pause(napi_env env, napi_value exports);
+extern void expose_ziti_resume(napi_env env, napi_value exports);
+extern void expose_ziti_set_high_water_mark(napi_env env, napi_value exports);
 
 //
 extern int tlsuv_websocket_init_with_src (uv_loop_t *loop, tlsuv_websocket_t *ws, tlsuv_src_t *src);
 
-extern void track_service_to_hostname(const char* service_name, char* hostname, int port);
+extern void track_service_to_hostname(const char* service_name, const char* hostname, int low_port, int high_port);
+extern void clear_service_hostnames(const char* service_name);
+extern void track_service_hostnames(const ServiceInfo* info);
+extern void invalidate_service_cache(const char *service_name, bool negatives);
+extern void clear_service_cache(void);
+extern void copy_service_info(ServiceInfo *info, const ziti_service *s);
+extern void free_service_info(ServiceInfo *info);
+extern void publish_service_event(const ziti_event_t *event);
+extern void update_service_table(const ziti_event_t *event);
+extern void for_each_service(void (*fn)(const ServiceInfo *info, void *ctx), void *ctx);
+extern ServiceInfo *copy_confirmed_services(size_t *count);
+extern const ServiceHostnameEntry* get_service_hostname(const char* service_name, int* port);
+extern const char* find_service_for_hostname(const char* hostname, int port);
+extern void restore_service(ServiceInfo *info);
+extern bool services_provisional(void);
+extern size_t load_service_cache(const char *path);
+extern void save_service_cache(void);
+
+extern napi_status create_external_buffer(napi_env env, void* data, size_t len, napi_value* result);
+extern napi_status create_dispatcher(napi_env env, napi_value js_cb, const char* name, napi_threadsafe_function_call_js call_js, Dispatcher** result);
+extern napi_status dispatch_to_js(Dispatcher* dispatcher, void* data);
+extern void release_dispatcher(Dispatcher* dispatcher);
+extern void enter_native_call(void);
+extern int start_net_thread(napi_env env);
+extern bool net_thread_enabled(void);
+extern uv_loop_t *get_ziti_loop(void);
+extern void run_on_ziti_thread(void (*fn)(void *arg), void *arg);
+extern bool reject_on_net_thread(napi_env env, const char *api);
+extern napi_status init_closed_write_dispatcher(napi_env env);
+extern void conn_data_delivered(ConnAddonData *addon_data, size_t bytes);
+extern void release_https_client(HttpsAddonData *addon_data);
+extern void finish_https_request_body(HttpsAddonData *addon_data);
+extern void flush_https_request_body(HttpsAddonData *addon_data);
+extern void fail_https_request_body(HttpsAddonData *addon_data, int code);
+extern napi_status create_https_req_handle(napi_env env, HttpsReq *httpsReq, napi_value *result);
+extern bool get_https_req(napi_env env, napi_value js_req, HttpsReq **result);
+extern void release_https_request(HttpsAddonData *addon_data);
+extern void cancel_https_request(HttpsAddonData *addon_data, int code);
+extern HttpsClientPool* get_https_client_pool(const char *scheme_host_port, bool create);
+extern bool get_https_pool_config(napi_env env, napi_value js_config, HttpsPoolConfig *config);
+extern void push_idle_https_client(HttpsClientPool *pool, HttpsClient *httpsClient);
+extern HttpsClient* pop_idle_https_client(HttpsClientPool *pool);
+extern void close_https_client(HttpsClient *httpsClient);
+extern void expose_ziti_https_pool_stats(napi_env env, napi_value exports);
+extern void expose_ziti_set_service_event_callback(napi_env env, napi_value exports);
+extern void expose_ziti_service_available_sync(napi_env env, napi_value exports);
+extern void expose_ziti_services_available_sync(napi_env env, napi_value exports);
+extern void expose_ziti_services_provisional(napi_env env, napi_value exports);
+extern void flush_corked_writes(ConnAddonData *addon_data);
+extern void fail_corked_writes(ConnAddonData *addon_data);
+extern void leave_native_call(void);
+extern napi_status create_on_write_dispatcher(napi_env env, Dispatcher** result);
+extern void on_ziti_conn_close(ziti_connection conn);
+extern void release_conn_addon_data(ConnAddonData *addon_data);
+extern bool conn_accepts_data(ConnAddonData *addon_data);
+extern int capture_request_headers(napi_env env, napi_value js_headers, RequestHeaders *headers);
+extern void apply_request_headers(tlsuv_http_req_t *req, const RequestHeaders *headers);
+extern void free_request_headers(RequestHeaders *headers);
 
 #ifdef __cplusplus
 }
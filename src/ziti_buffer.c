@@ -0,0 +1,58 @@
+/*
+Copyright NetFoundry Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ziti-nodejs.h"
+
+
+/**
+ * Invoked when the VM collects a Buffer created by create_external_buffer
+ */
+static void finalize_external_buffer(node_api_nogc_env env, void* data, void* hint) {
+  size_t len = (size_t)(uintptr_t)hint;
+
+  free(data);
+
+  // Tell the GC the native memory behind the Buffer is gone
+  napi_adjust_external_memory(env, -(int64_t)len, NULL);
+}
+
+
+/**
+ * Hand a heap block received from the C-SDK over to JavaScript as a Buffer, without copying it.
+ *
+ * Ownership of 'data' (which must have come from malloc) passes to this function; it is freed
+ * when the Buffer is collected, or right away if the runtime forbids external buffers and we
+ * had to fall back to a copy.
+ */
+napi_status create_external_buffer(napi_env env, void* data, size_t len, napi_value* result) {
+  napi_status status;
+
+  status = napi_create_external_buffer(env, len, data, finalize_external_buffer, (void*)(uintptr_t)len, result);
+  if (status == napi_ok) {
+    // Let the GC know how much native memory this Buffer is keeping alive
+    napi_adjust_external_memory(env, (int64_t)len, NULL);
+    return status;
+  }
+
+  if (status == napi_no_external_buffers_allowed) {
+    void* result_data;
+    status = napi_create_buffer_copy(env, len, data, &result_data, result);
+  }
+
+  free(data);
+
+  return status;
+}
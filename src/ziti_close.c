@@ -18,6 +18,82 @@ limitations under the License.
 #include <time.h> 
 
 
+static void free_coalesce_timer(uv_handle_t* handle) {
+  free(handle);
+}
+
+
+/**
+ * Free a connection's addon data, once the connection is closed and no writes or deliveries are outstanding.
+ * Connections created by ziti_dial own their dispatchers; accepted clients share their listener's.
+ * Anything already queued on a released dispatcher is still delivered before it is torn down.
+ */
+void release_conn_addon_data(ConnAddonData* addon_data) {
+
+  if (!addon_data->closed || (addon_data->pending_writes > 0) || (addon_data->undelivered_bytes > 0)) {
+    return;
+  }
+
+  ZITI_NODEJS_LOG(DEBUG, "freeing ConnAddonData: %p", addon_data);
+
+  if (addon_data->coalesce_timer != NULL) {
+    uv_close((uv_handle_t*)addon_data->coalesce_timer, free_coalesce_timer);
+  }
+
+  if (addon_data->listener == NULL) {
+    if (addon_data->on_connect != NULL) {
+      release_dispatcher(addon_data->on_connect);
+    }
+    if (addon_data->on_data != NULL) {
+      release_dispatcher(addon_data->on_data);
+    }
+    if (addon_data->on_write != NULL) {
+      release_dispatcher(addon_data->on_write);
+    }
+  }
+
+  free(addon_data);
+}
+
+
+/**
+ * Invoked by the C-SDK when a dialed or accepted connection has been closed.
+ */
+void on_ziti_conn_close(ziti_connection conn) {
+
+  ConnAddonData* addon_data = (ConnAddonData*) ziti_conn_data(conn);
+
+  ZITI_NODEJS_LOG(DEBUG, "conn: %p, addon_data: %p", conn, addon_data);
+
+  if (addon_data == NULL) {
+    return;
+  }
+  ziti_conn_set_data(conn, NULL);
+
+  // Writes still held back by cork/coalescing can no longer be sent
+  fail_corked_writes(addon_data);
+
+  addon_data->closed = true;
+  release_conn_addon_data(addon_data);
+}
+
+
+/**
+ * Runs on the thread that owns the connection
+ */
+static void close_command(void* arg) {
+  ziti_connection conn = (ziti_connection)arg;
+
+  // Send whatever cork/coalescing is still holding back before closing
+  ConnAddonData* addon_data = (ConnAddonData*) ziti_conn_data(conn);
+  if (addon_data != NULL) {
+    flush_corked_writes(addon_data);
+  }
+
+  ziti_close(conn, on_ziti_conn_close);
+}
+
+
 /**
  * 
  */
@@ -47,7 +123,68 @@ napi_value _ziti_close(napi_env env, const napi_callback_info info) {
 
   // Now, call the C-SDK to close the connection
   ZITI_NODEJS_LOG(DEBUG, "calling ziti_close for conn=%p", conn);
-  ziti_close(conn, NULL);
+  enter_native_call();
+  run_on_ziti_thread(close_command, conn);
+  leave_native_call();
+
+  status = napi_create_int32(env, 0, &jsRetval);
+  if (status != napi_ok) {
+    napi_throw_error(env, NULL, "Unable to create return value");
+  }
+
+  return jsRetval;
+}
+
+
+/**
+ * Runs on the thread that owns the connection; half-closes it once queued writes are sent
+ */
+static void close_write_command(void* arg) {
+  ziti_connection conn = (ziti_connection)arg;
+
+  ConnAddonData* addon_data = (ConnAddonData*) ziti_conn_data(conn);
+  if (addon_data != NULL) {
+    flush_corked_writes(addon_data);
+  }
+
+  ziti_close_write(conn);
+}
+
+
+/**
+ * 
+ */
+napi_value _ziti_close_write(napi_env env, const napi_callback_info info) {
+  napi_status status;
+  size_t argc = 1;
+  napi_value args[1];
+  napi_value jsRetval;
+
+  status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  if (status != napi_ok) {
+    napi_throw_error(env, NULL, "Failed to parse arguments");
+    return NULL;
+  }
+
+  if (argc < 1) {
+    napi_throw_error(env, "EINVAL", "Too few arguments");
+    return NULL;
+  }
+
+  // Obtain ziti_connection
+  int64_t js_conn;
+  status = napi_get_value_int64(env, args[0], &js_conn);
+  if (status != napi_ok) {
+    napi_throw_error(env, NULL, "Failed to get Conn");
+    return NULL;
+  }
+  ziti_connection conn = (ziti_connection)js_conn;
+
+  // Now, call the C-SDK to half-close the connection
+  ZITI_NODEJS_LOG(DEBUG, "calling ziti_close_write for conn=%p", conn);
+  enter_native_call();
+  run_on_ziti_thread(close_write_command, conn);
+  leave_native_call();
 
   status = napi_create_int32(env, 0, &jsRetval);
   if (status != napi_ok) {
@@ -77,3 +214,23 @@ void expose_ziti_close(napi_env env, napi_value exports) {
 
 }
 
+
+
+/**
+ * 
+ */
+void expose_ziti_close_write(napi_env env, napi_value exports) {
+  napi_status status;
+  napi_value fn;
+
+  status = napi_create_function(env, NULL, 0, _ziti_close_write, NULL, &fn);
+  if (status != napi_ok) {
+    napi_throw_error(env, NULL, "Unable to wrap native function '_ziti_close_write");
+  }
+
+  status = napi_set_named_property(env, exports, "ziti_close_write", fn);
+  if (status != napi_ok) {
+    napi_throw_error(env, NULL, "Unable to populate exports for 'ziti_close_write");
+  }
+
+}
@@ -37,7 +37,6 @@ static const char *ALL_CONFIG_TYPES[] = {
         NULL
 };
 
-#define ZROK_PROXY_CFG_V1 "zrok.proxy.v1"
 #define ZROK_PROXY_CFG_V1_MODEL(XX, ...) \
 XX(auth_scheme, model_string, none, auth_scheme, __VA_ARGS__) \
 XX(basic_auth, model_string, none, basic_auth, __VA_ARGS__) \
@@ -82,6 +81,14 @@ static void CallJs(napi_env env, napi_value js_cb, void* context, void* data) {
   }
 }
 
+// The context's latest controller/authentication status, set on the thread that runs the context and
+// read from JS. Once init has completed (early, from the service cache) it is the only way a later failure shows.
+static int32_t context_status = ZITI_OK;
+
+static void set_context_status(int rc) {
+    ZITI_ATOMIC_STORE_INT32(&context_status, (int32_t)rc);
+}
+
 static void complete_init(AddonData *addon_data, int rc) {
     if (addon_data && addon_data->tsfn) {
         napi_call_threadsafe_function(addon_data->tsfn, (void *) (long) rc, napi_tsfn_blocking);
@@ -168,18 +175,26 @@ static void on_ziti_event(ziti_context _ztx, const ziti_event_t *event) {
           }
 
           addon_data->zitiContextEventStatus = event->ctx.ctrl_status;
+          set_context_status(event->ctx.ctrl_status);
 
           break;
 
       case ZitiServiceEvent:
+          publish_service_event(event);
+          save_service_cache();
+
           if (event->service.removed != NULL) {
               for (ziti_service **sp = event->service.removed; *sp != NULL; sp++) {
                   // service_check_cb(ztx, *sp, ZITI_SERVICE_UNAVAILABLE, app_ctx);
                   ZITI_NODEJS_LOG(INFO, "Service removed [%s]", (*sp)->name);
+                  clear_service_hostnames((*sp)->name);
+                  invalidate_service_cache((*sp)->name, false);
               }
           }
 
           if (event->service.added != NULL) {
+              // New services may intercept addresses that were cached as having none, or as another service
+              clear_service_cache();
               for (ziti_service **sp = event->service.added; *sp != NULL; sp++) {
                   // service_check_cb(ztx, *sp, ZITI_OK, app_ctx);
                   ZITI_NODEJS_LOG(INFO, "Service added [%s]", (*sp)->name);
@@ -193,85 +208,19 @@ static void on_ziti_event(ziti_context _ztx, const ziti_event_t *event) {
               }
           }
 
-          //
           for (int i = 0; event->service.added && event->service.added[i] != NULL; i++) {
-
-              ziti_service *s = event->service.added[i];
-              ziti_intercept_cfg_v1 *intercept = alloc_ziti_intercept_cfg_v1();
-              ziti_client_cfg_v1 clt_cfg = {
-                      .hostname = {0},
-                      .port = 0
-              };
-              zrok_proxy_cfg_v1 zrok_cfg = {
-                      .auth_scheme = "",
-                      .basic_auth = "",
-                      .oauth = ""
-              };
-
-              if (ziti_service_get_config(s, ZITI_INTERCEPT_CFG_V1, intercept,
-                                          (int (*)(void *, const char *, size_t)) parse_ziti_intercept_cfg_v1) ==
-                  ZITI_OK) {
-
-                  const ziti_address *range_addr;
-                  MODEL_LIST_FOREACH(range_addr, intercept->addresses) {
-                      ziti_port_range *p;
-                      MODEL_LIST_FOREACH(p, intercept->port_ranges) {
-                          int lowport = p->low;
-                          while (lowport <= p->high) {
-                              track_service_to_hostname(s->name, (char *) range_addr->addr.hostname, lowport);
-                              lowport++;
-                          }
-                      }
-                  }
-
-              } else if (ziti_service_get_config(s, ZITI_CLIENT_CFG_V1, &clt_cfg, (int (*)(void *, const char *,
-                                                                                           unsigned long)) parse_ziti_client_cfg_v1) ==
-                         ZITI_OK) {
-                  track_service_to_hostname(s->name, clt_cfg.hostname.addr.hostname, clt_cfg.port);
-
-              } else if (ziti_service_get_config(s, ZROK_PROXY_CFG_V1, &zrok_cfg, (int (*)(void *, const char *,
-                                                                                           unsigned long)) parse_ziti_client_cfg_v1) ==
-                         ZITI_OK) {
-                  track_service_to_hostname(s->name, s->name, 80);
-              }
-
-              free_ziti_intercept_cfg_v1(intercept);
-              free(intercept);
+              ServiceInfo info;
+              copy_service_info(&info, event->service.added[i]);
+              track_service_hostnames(&info);
+              free_service_info(&info);
           }
 
           for (int i = 0; event->service.changed && event->service.changed[i] != NULL; i++) {
-
-              ziti_service *s = event->service.changed[i];
-              ziti_intercept_cfg_v1 *intercept = alloc_ziti_intercept_cfg_v1();
-              ziti_client_cfg_v1 clt_cfg = {
-                      .hostname = {0},
-                      .port = 0
-              };
-
-              if (ziti_service_get_config(s, ZITI_INTERCEPT_CFG_V1, intercept,
-                                          (int (*)(void *, const char *, size_t)) parse_ziti_intercept_cfg_v1) ==
-                  ZITI_OK) {
-
-                  const ziti_address *range_addr;
-                  MODEL_LIST_FOREACH(range_addr, intercept->addresses) {
-                      ziti_port_range *p;
-                      MODEL_LIST_FOREACH(p, intercept->port_ranges) {
-                          int lowport = p->low;
-                          while (lowport <= p->high) {
-                              track_service_to_hostname(s->name, (char *) range_addr->addr.hostname, lowport);
-                              lowport++;
-                          }
-                      }
-                  }
-
-              } else if (ziti_service_get_config(s, ZITI_CLIENT_CFG_V1, &clt_cfg, (int (*)(void *, const char *,
-                                                                                           unsigned long)) parse_ziti_client_cfg_v1) ==
-                         ZITI_OK) {
-                  track_service_to_hostname(s->name, clt_cfg.hostname.addr.hostname, clt_cfg.port);
-              }
-
-              free_ziti_intercept_cfg_v1(intercept);
-              free(intercept);
+              ServiceInfo info;
+              copy_service_info(&info, event->service.changed[i]);
+              invalidate_service_cache(info.name, true);
+              track_service_hostnames(&info);
+              free_service_info(&info);
           }
 
           // Initiate the call into the JavaScript 'on_init' callback, now that we know about all the services
@@ -327,6 +276,7 @@ static void on_ziti_event(ziti_context _ztx, const ziti_event_t *event) {
           // Only complete init with failure for cannot_continue
           // For other auth events, the JS code will handle authentication
           if (should_fail) {
+              set_context_status(status);
               complete_init(addon_data, status);
           }
           break;
@@ -356,6 +306,53 @@ static void on_ziti_event(ziti_context _ztx, const ziti_event_t *event) {
 }
 
 
+/**
+ * Start the context on the network thread's loop
+ */
+static void run_ztx_command(void *arg) {
+    AddonData *addon_data = (AddonData *)arg;
+
+    int rc = ziti_context_run(ztx, get_ziti_loop());
+    ZITI_NODEJS_LOG(DEBUG, "ziti_context_run => %d", rc);
+    if (rc != ZITI_OK) {
+        set_context_status(rc);
+        complete_init(addon_data, rc);
+    }
+}
+
+/**
+ * Stop the context, on the thread that owns it: that is the thread that reads 'ztx' and calls and
+ * releases the addon's tsfns, so nothing else may touch them
+ */
+static void shutdown_ztx_command(void *arg) {
+    (void) arg;
+    if (ztx == NULL) {
+        return;
+    }
+    ziti_context local_ztx = ztx;
+    ztx = NULL;
+
+    AddonData *addon_data = (AddonData*)ziti_app_ctx(local_ztx);
+    if (addon_data) {
+        if (addon_data->tsfn) {
+            napi_release_threadsafe_function(addon_data->tsfn, napi_tsfn_release);
+            addon_data->tsfn = NULL;
+        }
+        if (addon_data->tsfn_on_auth_event) {
+            napi_release_threadsafe_function(addon_data->tsfn_on_auth_event, napi_tsfn_release);
+            addon_data->tsfn_on_auth_event = NULL;
+        }
+        // Don't free addon_data here — ziti_shutdown() is async and
+        // its events still reference addon_data via ziti_app_ctx().
+        // The nulled-out tsfn pointers ensure the event handlers no-op safely.
+    }
+    ziti_shutdown(local_ztx);
+}
+
+// Whether a context was loaded and not yet shut down; only used on the JS thread, which must not
+// read 'ztx' once the network thread owns it
+static bool ztx_loaded = false;
+
 /**
  * 
  */
@@ -365,8 +362,8 @@ static napi_value load_ztx(napi_env env, napi_callback_info info) {
 
     ZITI_NODEJS_LOG(DEBUG, "initializing");
 
-    size_t argc = 3;
-    napi_value args[3];
+    size_t argc = 5;
+    napi_value args[5];
     NAPI_CHECK(env, "parse args", napi_get_cb_info(env, info, &argc, args, NULL, NULL));
     if (argc < 2) {
         napi_throw_error(env, "EINVAL", "Too few arguments");
@@ -388,7 +385,11 @@ static napi_value load_ztx(napi_env env, napi_callback_info info) {
     }
     ZITI_NODEJS_LOG(DEBUG, "config_file_name: %s", config_file_name);
 
+    set_context_status(ZITI_OK);
+    clear_service_cache();
+
     ziti_config cfg = {0};
+    const char *err_msg = NULL;             // what to throw on failure, when not ziti_errorstr(rc)
     int rc = ziti_load_config(&cfg, config_file_name);
     ZITI_NODEJS_LOG(DEBUG, "ziti_load_config => %d", rc);
     if (rc != ZITI_OK) {
@@ -457,8 +458,51 @@ static napi_value load_ztx(napi_env env, napi_callback_info info) {
     ZITI_NODEJS_LOG(DEBUG, "ziti_context_set_options => %d", rc);
     if (rc != ZITI_OK) goto done;
 
-    rc = ziti_context_run(ztx, thread_loop);
-    ZITI_NODEJS_LOG(DEBUG, "ziti_context_run => %d", rc);
+    // Handle optional network-thread flag (fourth argument)
+    bool network_thread = false;
+    if (argc >= 4) {
+        napi_valuetype arg_type;
+        status = napi_typeof(env, args[3], &arg_type);
+        if (status == napi_ok && arg_type == napi_boolean) {
+            NAPI_CHECK(env, "get network thread flag", napi_get_value_bool(env, args[3], &network_thread));
+        }
+    }
+
+    // Handle optional service cache path (fifth argument). Once it restores any services, init
+    // completes right away; the controller's first service event then reconciles the restored services.
+    if (argc >= 5) {
+        napi_valuetype arg_type;
+        status = napi_typeof(env, args[4], &arg_type);
+        if (status == napi_ok && arg_type == napi_string) {
+            size_t cache_path_len;
+            NAPI_CHECK(env, "get service cache path length", napi_get_value_string_utf8(env, args[4], NULL, 0, &cache_path_len));
+            char *cache_path = calloc(1, cache_path_len + 1);
+            NAPI_CHECK(env, "get service cache path", napi_get_value_string_utf8(env, args[4], cache_path, cache_path_len + 1, &result));
+            if (load_service_cache(cache_path) > 0) {
+                complete_init(addon_data, ZITI_OK);
+            }
+            free(cache_path);
+        }
+    }
+
+    // Once started, the network thread owns every later context too: the connection, timer and
+    // file APIs route to it from then on, so a re-init without the option still runs there
+    if (network_thread || net_thread_enabled()) {
+        int uv_rc = start_net_thread(env);
+        if (uv_rc != 0) {
+            ZITI_NODEJS_LOG(ERROR, "failed to start the network thread: %s", uv_strerror(uv_rc));
+            err_msg = uv_strerror(uv_rc);
+            rc = ZITI_INVALID_STATE;
+            goto done;
+        }
+
+        // The context has to be started from the thread that will run it; any failure
+        // is reported through the init callback
+        run_on_ziti_thread(run_ztx_command, addon_data);
+    } else {
+        rc = ziti_context_run(ztx, thread_loop);
+        ZITI_NODEJS_LOG(DEBUG, "ziti_context_run => %d", rc);
+    }
 
     done:
     if (rc != ZITI_OK) {
@@ -471,11 +515,13 @@ static napi_value load_ztx(napi_env env, napi_callback_info info) {
             }
             free(addon_data);
         }
-        napi_throw_error(env, "EINVAL", ziti_errorstr(rc));
+        napi_throw_error(env, "EINVAL", (err_msg != NULL) ? err_msg : ziti_errorstr(rc));
         if (ztx) {
             ziti_shutdown(ztx);
             ztx = NULL;
         }
+    } else {
+        ztx_loaded = true;
     }
 
     NAPI_CHECK(env, "create return value", napi_create_int32(env, rc, &jsRetval));
@@ -483,28 +529,13 @@ static napi_value load_ztx(napi_env env, napi_callback_info info) {
 }
 
 static napi_value ztx_shutdown(napi_env env, napi_callback_info info) {
-    ZITI_NODEJS_LOG(DEBUG, "ztx: %p", ztx);
+    ZITI_NODEJS_LOG(DEBUG, "loaded: %d", ztx_loaded);
     NAPI_UNDEFINED(env, jsRetval);
-    if (ztx) {
-        ziti_context local_ztx = ztx;
-        ztx = NULL;
-
-        AddonData *addon_data = (AddonData*)ziti_app_ctx(local_ztx);
-        if (addon_data) {
-            if (addon_data->tsfn) {
-                napi_release_threadsafe_function(addon_data->tsfn, napi_tsfn_release);
-                addon_data->tsfn = NULL;
-            }
-            if (addon_data->tsfn_on_auth_event) {
-                napi_release_threadsafe_function(addon_data->tsfn_on_auth_event, napi_tsfn_release);
-                addon_data->tsfn_on_auth_event = NULL;
-            }
-            // Don't free addon_data here — ziti_shutdown() is async and
-            // its events still reference addon_data via ziti_app_ctx().
-            // The nulled-out tsfn pointers ensure the event handlers no-op safely.
-        }
-        ziti_shutdown(local_ztx);
+    if (ztx_loaded) {
+        ztx_loaded = false;
+        run_on_ziti_thread(shutdown_ztx_command, NULL);
     }
+    clear_service_cache();
     return jsRetval;
 }
 
@@ -514,6 +545,30 @@ ZNODE_EXPOSE(ziti_init, load_ztx)
 ZNODE_EXPOSE(ziti_shutdown, ztx_shutdown)
 
 
+/**
+ * { status, error }: the context's latest controller/authentication status (0 when fine, or not yet known),
+ * and for a failure its description
+ */
+static napi_value _ziti_context_status(napi_env env, napi_callback_info info) {
+    (void) info;
+    int32_t rc = ZITI_ATOMIC_LOAD_INT32(&context_status);
+
+    napi_value js_status, js_rc;
+    NAPI_CHECK(env, "create status", napi_create_object(env, &js_status));
+    NAPI_CHECK(env, "create status code", napi_create_int32(env, rc, &js_rc));
+    NAPI_CHECK(env, "set status code", napi_set_named_property(env, js_status, "status", js_rc));
+    if (rc != ZITI_OK) {
+        napi_value js_err;
+        const char *msg = (rc == ZITI_EXTERNAL_LOGIN_REQUIRED) ? "additional authentication is not supported" : ziti_errorstr(rc);
+        NAPI_CHECK(env, "create status error", napi_create_string_utf8(env, msg, NAPI_AUTO_LENGTH, &js_err));
+        NAPI_CHECK(env, "set status error", napi_set_named_property(env, js_status, "error", js_err));
+    }
+    return js_status;
+}
+
+ZNODE_EXPOSE(ziti_context_status, _ziti_context_status)
+
+
 /**
  * Data structure for external auth initialization
  */
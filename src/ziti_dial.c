@@ -17,14 +17,6 @@ limitations under the License.
 #include "ziti-nodejs.h"
 #include <string.h>
 
-// An item that will be generated here and passed into the JavaScript on_data callback
-typedef struct OnDataItem {
-
-  const unsigned char *buf;
-  int len;
-
-} OnDataItem;
-
 /**
  * This function is responsible for calling the JavaScript 'connect' callback function 
  * that was specified when the ziti_dial(...) was called from JavaScript.
@@ -84,9 +76,57 @@ static void CallJs_on_connect(napi_env env, napi_value js_cb, void* context, voi
 }
 
 
+/**
+ * Turn the chunks queued on a connection into the argument for the JavaScript on_data callback:
+ * a single Buffer (concatenated if need be), or an Array of Buffers.
+ * Ownership of every chunk's buf passes to the returned value.
+ */
+static napi_status create_js_data(napi_env env, ConnAddonData* addon_data, OnDataItem* head, size_t count, size_t bytes, napi_value* result) {
+  napi_status status;
+
+  if (addon_data->data_mode == DATA_MODE_ARRAY) {
+    status = napi_create_array_with_length(env, count, result);
+    if (status != napi_ok) {
+      return status;
+    }
+    uint32_t i = 0;
+    for (OnDataItem* item = head; item != NULL; item = item->next) {
+      napi_value js_buffer;
+      status = create_external_buffer(env, item->buf, item->len, &js_buffer);
+      item->buf = NULL;
+      if (status == napi_ok) {
+        status = napi_set_element(env, *result, i++, js_buffer);
+      }
+      if (status != napi_ok) {
+        return status;
+      }
+    }
+    return napi_ok;
+  }
+
+  // A lone chunk is wrapped as-is; several are gathered into one block first
+  if (count == 1) {
+    status = create_external_buffer(env, head->buf, head->len, result);
+    head->buf = NULL;
+    return status;
+  }
+
+  unsigned char* buf = malloc(bytes);
+  size_t offset = 0;
+  for (OnDataItem* item = head; item != NULL; item = item->next) {
+    memcpy(buf + offset, item->buf, item->len);
+    offset += item->len;
+  }
+  return create_external_buffer(env, buf, bytes, result);
+}
+
+
 /**
  * This function is responsible for calling the JavaScript 'data' callback function 
  * that was specified when the ziti_dial(...) was called from JavaScript.
+ *
+ * It is queued once per batch: every chunk that arrived on the connection before
+ * it ran is handed over in this one call.
  */
 static void CallJs_on_data(napi_env env, napi_value js_cb, void* context, void* data) {
   napi_status status;
@@ -94,25 +134,36 @@ static void CallJs_on_data(napi_env env, napi_value js_cb, void* context, void*
   // This parameter is not used.
   (void) context;
 
-  // Retrieve the OnDataItem created by the worker thread.
-  OnDataItem* item = (OnDataItem*)data;
+  ConnAddonData* addon_data = (ConnAddonData*)data;
+
+  // Take the whole batch; the next chunk to arrive finds the stack empty and schedules a new delivery
+  OnDataItem* item = ZITI_ATOMIC_XCHG_PTR(&addon_data->inbound, NULL);
+
+  // The stack is newest first; reverse it to deliver in arrival order
+  OnDataItem* head = NULL;
+  size_t count = 0, bytes = 0;
+  while (item != NULL) {
+    OnDataItem* next = item->next;
+    item->next = head;
+    head = item;
+    count++;
+    bytes += item->len;
+    item = next;
+  }
 
   // env and js_cb may both be NULL if Node.js is in its cleanup phase, and
   // items are left over from earlier thread-safe calls from the worker thread.
   // When env is NULL, we simply skip over the call into Javascript and free the
   // items.
-  if (env != NULL) {
-    napi_value undefined, js_buffer;
-    void* result_data;
-
-    // Convert the buffer to a napi_value.
-    status = napi_create_buffer_copy(env,
-                              item->len,
-                              (const void*)item->buf,
-                              (void**)&result_data,
-                              &js_buffer);
+  if ((env != NULL) && (head != NULL)) {
+    napi_value undefined, js_data;
+
+    ZITI_NODEJS_LOG(DEBUG, "delivering %zu chunk(s), %zu bytes, addon_data: %p", count, bytes, addon_data);
+
+    // Wrap the data in a napi_value without copying a lone chunk again; the JS value now owns the bufs
+    status = create_js_data(env, addon_data, head, count, bytes, &js_data);
     if (status != napi_ok) {
-      napi_throw_error(env, NULL, "Unable to napi_create_buffer_copy");
+      napi_throw_error(env, NULL, "Unable to create_external_buffer");
     }
 
     // Retrieve the JavaScript `undefined` value so we can use it as the `this`
@@ -128,13 +179,23 @@ static void CallJs_on_data(napi_env env, napi_value js_cb, void* context, void*
         undefined,
         js_cb,
         1,
-        &js_buffer,
+        &js_data,
         NULL
       );
     if (status != napi_ok) {
       napi_throw_error(env, NULL, "Unable to napi_call_function");
     }
   }
+
+  while (head != NULL) {
+    OnDataItem* next = head->next;
+    free(head->buf);
+    free(head);
+    head = next;
+  }
+
+  // The bytes are JS's now; this may let the C-SDK resume flushing to us
+  conn_data_delivered(addon_data, bytes);
 }
 
 
@@ -154,35 +215,56 @@ long on_data(struct ziti_conn *conn, const unsigned char *buf, long len) {
       ZITI_NODEJS_LOG(DEBUG, "skipping ziti_close on ZITI_EOF due to isWebsocket=true");
       return 0;
     } else {
-      ziti_close(conn, NULL);
+      ziti_close(conn, on_ziti_conn_close);
       return 0;
     }
   }
   else if (len < 0) {
-    ziti_close(conn, NULL);
+    ziti_close(conn, on_ziti_conn_close);
     return 0;
   }
   else {
 
+    // Leave the data with the C-SDK (which applies backpressure on the circuit) while JS is not keeping up
+    if (!conn_accepts_data(addon_data)) {
+      ZITI_NODEJS_LOG(DEBUG, "deferring %ld bytes, conn: %p, paused: %d, undelivered: %zu", len, conn, addon_data->paused, addon_data->undelivered_bytes);
+      addon_data->refused = true;
+      return 0;
+    }
+
+    // This is the only copy made on the inbound path; the C-SDK reuses 'buf' once we return
     OnDataItem* item = memset(malloc(sizeof(*item)), 0, sizeof(*item));
-    item->buf = buf;
-    item->buf = calloc(1, len);
-    memcpy((void*)item->buf, buf, len);
+    item->buf = malloc(len);
+    memcpy(item->buf, buf, len);
     item->len = len;
 
     // if (addon_data->isWebsocket) {
     //   hexDump("on_data", item->buf, item->len);
     // }
 
+    // Count the chunk before it becomes visible to CallJs_on_data
+    addon_data->undelivered_bytes += len;
+
+    // Push the chunk onto the connection's stack. If the stack was not empty, a delivery is
+    // already pending and will pick this chunk up along with the rest of the batch.
+    OnDataItem* prev;
+    do {
+      prev = ZITI_ATOMIC_LOAD_PTR(&addon_data->inbound);
+      item->next = prev;
+    } while (!ZITI_ATOMIC_CAS_PTR(&addon_data->inbound, prev, item));
+
+    if (prev != NULL) {
+      return len;
+    }
+
     // Initiate the call into the JavaScript callback. 
-    // The call into JavaScript will not have happened 
-    // when this function returns, but it will be queued.
-    status = napi_call_threadsafe_function(
-        addon_data->tsfn_on_data,        
-        item,  // Send the data we received from the service on over to the JS callback
-        napi_tsfn_blocking);
+    // The call into JavaScript has either happened already
+    // when this function returns, or it has been queued.
+    status = dispatch_to_js(
+        addon_data->on_data,
+        addon_data);  // The JS callback drains whatever has been pushed onto the connection by then
     if (status != napi_ok) {
-      ZITI_NODEJS_LOG(ERROR, "Unable to napi_call_threadsafe_function");
+      ZITI_NODEJS_LOG(ERROR, "Unable to dispatch_to_js");
     }
 
     return len;
@@ -213,15 +295,82 @@ void on_connect(ziti_connection conn, int status) {
     ZITI_NODEJS_LOG(DEBUG, "the_conn: %p", the_conn);
 
   // Initiate the call into the JavaScript callback. 
-  // The call into JavaScript will not have happened 
-  // when this function returns, but it will be queued.
-  nstatus = napi_call_threadsafe_function(
-      addon_data->tsfn_on_connect,
-      the_conn,   // Send the ziti_connection over to the JS callback
-      napi_tsfn_blocking);
-    if (nstatus != napi_ok) {
-      ZITI_NODEJS_LOG(ERROR, "Unable to napi_call_threadsafe_function");
+  // The call into JavaScript has either happened already
+  // when this function returns, or it has been queued.
+  nstatus = dispatch_to_js(
+      addon_data->on_connect,
+      the_conn);  // Send the ziti_connection over to the JS callback
+  if (nstatus != napi_ok) {
+    ZITI_NODEJS_LOG(ERROR, "Unable to dispatch_to_js");
+  }
+}
+
+
+/**
+ * Init a Ziti connection object, attach our add-on data to it, and connect to the service.
+ * Runs on the thread that owns the ziti_context.
+ */
+static int start_dial(ConnAddonData* addon_data, const char* service_name) {
+
+  // Init a Ziti connection object, and attach our add-on data to it so we can 
+  // pass context around between our callbacks, as propagate it all the way out
+  // to the JavaScript callbacks
+  ziti_connection conn;
+  int rc = ziti_conn_init(ztx, &conn, addon_data);
+  if (rc != ZITI_OK) {
+    ZITI_NODEJS_LOG(ERROR, "failure in ziti_conn_init: %d", rc);
+    return rc;
+  }
+  addon_data->conn = conn;
+
+  // Connect to the service
+  ZITI_NODEJS_LOG(DEBUG, "calling ziti_dial: %p", ztx);
+  rc = ziti_dial(conn, service_name, on_connect, on_data);
+  if (rc != ZITI_OK) {
+    ZITI_NODEJS_LOG(ERROR, "failure in ziti_dial: %d", rc);
+  }
+  ZITI_NODEJS_LOG(DEBUG, "returned from ziti_dial: %p", ztx);
+
+  return rc;
+}
+
+
+/**
+ * Release everything a failed start_dial leaves behind: the connection, if it was initialised (closing it
+ * frees the add-on data and its dispatchers once the C-SDK is done with it), or else the add-on data itself.
+ * Runs on the thread that owns the ziti_context.
+ */
+static void abandon_dial(ConnAddonData* addon_data) {
+  if (addon_data->conn != NULL) {
+    ziti_close(addon_data->conn, on_ziti_conn_close);
+  } else {
+    addon_data->closed = true;
+    release_conn_addon_data(addon_data);
+  }
+}
+
+
+// A dial queued for the network thread
+typedef struct DialItem {
+  ConnAddonData *addon_data;
+  char *service_name;
+} DialItem;
+
+
+static void dial_command(void* arg) {
+  DialItem* item = (DialItem*)arg;
+
+  int rc = start_dial(item->addon_data, item->service_name);
+  if (rc != ZITI_OK) {
+    // Tell JS the dial failed, the same way on_connect does
+    if (dispatch_to_js(item->addon_data->on_connect, NULL) != napi_ok) {
+      ZITI_NODEJS_LOG(ERROR, "Unable to dispatch_to_js");
     }
+    abandon_dial(item->addon_data);
+  }
+
+  free(item->service_name);
+  free(item);
 }
 
 
@@ -231,8 +380,8 @@ void on_connect(ziti_connection conn, int status) {
 napi_value _ziti_dial(napi_env env, const napi_callback_info info) {
 
   napi_status status;
-  size_t argc = 4;
-  napi_value args[4];
+  size_t argc = 5;
+  napi_value args[5];
   status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   if (status != napi_ok) {
     napi_throw_error(env, NULL, "Failed to parse arguments");
@@ -262,95 +411,68 @@ napi_value _ziti_dial(napi_env env, const napi_callback_info info) {
 
   // Obtain ptr to JS 'connect' callback function
   napi_value js_connect_cb = args[2];
-  napi_value work_name_connect;
 
   ConnAddonData* addon_data = memset(malloc(sizeof(*addon_data)), 0, sizeof(*addon_data));
 
   addon_data->isWebsocket = isWebsocket;
-
-  // Create a string to describe this asynchronous operation.
-  status = napi_create_string_utf8(
-    env,
-    "N-API on_connect",
-    NAPI_AUTO_LENGTH,
-    &work_name_connect);
-  if (status != napi_ok) {
-    napi_throw_error(env, NULL, "Unable to napi_create_string_utf8");
+  addon_data->high_water_mark = ZITI_NODEJS_DEFAULT_HIGH_WATER_MARK;
+
+  // Obtain optional data mode: how chunks that arrive together are handed to the 'data' callback
+  if (argc > 4) {
+    napi_valuetype js_type;
+    char data_mode[16];
+    if ((napi_typeof(env, args[4], &js_type) == napi_ok) && (js_type == napi_string)) {
+      status = napi_get_value_string_utf8(env, args[4], data_mode, sizeof(data_mode), NULL);
+      if ((status == napi_ok) && (strcmp(data_mode, "array") == 0)) {
+        addon_data->data_mode = DATA_MODE_ARRAY;
+      }
+    }
   }
+  ZITI_NODEJS_LOG(DEBUG, "data_mode is: %d", addon_data->data_mode);
 
-  // Convert the callback retrieved from JavaScript into a thread-safe function (tsfn) 
-  // which we can call from a worker thread.
-  status = napi_create_threadsafe_function(
-      env,
-      js_connect_cb,
-      NULL,
-      work_name_connect,
-      0,
-      1,
-      NULL,
-      NULL,
-      NULL,
-      CallJs_on_connect,
-      &(addon_data->tsfn_on_connect));
+  // Create the dispatchers that deliver our callbacks into JS
+  status = create_dispatcher(env, js_connect_cb, "N-API on_connect", CallJs_on_connect, &(addon_data->on_connect));
   if (status != napi_ok) {
-    napi_throw_error(env, NULL, "Unable to napi_create_threadsafe_function");
+    napi_throw_error(env, NULL, "Unable to create_dispatcher");
   }
 
   // Obtain ptr to JS 'data' callback function
   napi_value js_data_cb = args[3];
-  napi_value work_name_data;
-
-  // Create a string to describe this asynchronous operation.
-  status = napi_create_string_utf8(
-    env,
-    "N-API on_data",
-    NAPI_AUTO_LENGTH,
-    &work_name_data);
+
+  status = create_dispatcher(env, js_data_cb, "N-API on_data", CallJs_on_data, &(addon_data->on_data));
   if (status != napi_ok) {
-    napi_throw_error(env, NULL, "Unable to napi_create_string_utf8");
+    napi_throw_error(env, NULL, "Unable to create_dispatcher");
   }
 
-  // Convert the callback retrieved from JavaScript into a thread-safe function (tsfn) 
-  // which we can call from a worker thread.
-  status = napi_create_threadsafe_function(
-      env,
-      js_data_cb,
-      NULL,
-      work_name_data,
-      0,
-      1,
-      NULL,
-      NULL,
-      NULL,
-      CallJs_on_data,
-      &(addon_data->tsfn_on_data));
+  // Create the write-completion dispatcher once, so each ziti_write need not create its own
+  status = create_on_write_dispatcher(env, &(addon_data->on_write));
   if (status != napi_ok) {
-    napi_throw_error(env, NULL, "Unable to napi_create_threadsafe_function");
+    napi_throw_error(env, NULL, "Unable to create_dispatcher");
   }
   
-  // Init a Ziti connection object, and attach our add-on data to it so we can 
-  // pass context around between our callbacks, as propagate it all the way out
-  // to the JavaScript callbacks
-  ziti_connection conn;
-  int rc = ziti_conn_init(ztx, &conn, addon_data);
-  if (rc != ZITI_OK) {
-    napi_throw_error(env, NULL, "failure in 'ziti_conn_init");
+  // With the network thread, the dial happens there, and a failure is reported through the 'connect' callback
+  if (net_thread_enabled()) {
+    DialItem* item = calloc(1, sizeof(*item));
+    item->addon_data = addon_data;
+    item->service_name = strdup(ServiceName);
+    run_on_ziti_thread(dial_command, item);
+    return NULL;
   }
 
-
-  // Connect to the service
-  ZITI_NODEJS_LOG(DEBUG, "calling ziti_dial: %p", ztx);
-  rc = ziti_dial(conn, ServiceName, on_connect, on_data);
+  enter_native_call();
+  int rc = start_dial(addon_data, ServiceName);
+  if (rc != ZITI_OK) {
+    abandon_dial(addon_data);
+  }
+  leave_native_call();
   if (rc != ZITI_OK) {
     napi_throw_error(env, NULL, "failure in 'ziti_dial");
   }
-  ZITI_NODEJS_LOG(DEBUG, "returned from ziti_dial: %p", ztx);
 
   return NULL;
 }
 
 
-
 /**
  * 
  */
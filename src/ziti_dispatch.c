@@ -0,0 +1,176 @@
+/*
+Copyright NetFoundry Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ziti-nodejs.h"
+
+
+// How many calls from JS into the addon are currently on the JS thread's stack
+static int native_call_depth = 0;
+
+
+/**
+ * Bracket a call into the C-SDK made on behalf of JS. Any callback the C-SDK raises
+ * synchronously in between is queued rather than re-entering JS under the caller.
+ */
+void enter_native_call(void) {
+  native_call_depth++;
+}
+
+void leave_native_call(void) {
+  native_call_depth--;
+}
+
+
+/**
+ * Invoked on the JS thread once the dispatcher's tsfn has been released and drained
+ */
+static void finalize_dispatcher(napi_env env, void* finalize_data, void* finalize_hint) {
+  Dispatcher* dispatcher = (Dispatcher*)finalize_data;
+
+  (void) finalize_hint;
+
+  if (dispatcher->js_cb != NULL) {
+    napi_delete_reference(env, dispatcher->js_cb);
+  }
+  napi_delete_reference(env, dispatcher->resource);
+  napi_async_destroy(env, dispatcher->async_context);
+
+  free(dispatcher);
+}
+
+
+/**
+ * Create a dispatcher for a JS callback. 'js_cb' may be NULL when the function to call
+ * travels with each item instead; 'call_js' is the usual CallJs_* marshaller.
+ */
+napi_status create_dispatcher(napi_env env, napi_value js_cb, const char* name, napi_threadsafe_function_call_js call_js, Dispatcher** result) {
+  napi_status status;
+  napi_value work_name, resource;
+
+  Dispatcher* dispatcher = calloc(1, sizeof(*dispatcher));
+  dispatcher->env = env;
+  dispatcher->call_js = call_js;
+  dispatcher->thread = uv_thread_self();
+
+  // Create a string to describe this asynchronous operation.
+  status = napi_create_string_utf8(env, name, NAPI_AUTO_LENGTH, &work_name);
+  if (status != napi_ok) {
+    free(dispatcher);
+    return status;
+  }
+
+  // The async context lets direct calls show up to async_hooks just like tsfn calls do
+  status = napi_create_object(env, &resource);
+  if (status == napi_ok) {
+    status = napi_create_reference(env, resource, 1, &dispatcher->resource);
+  }
+  if (status == napi_ok) {
+    status = napi_async_init(env, resource, work_name, &dispatcher->async_context);
+  }
+  if ((status == napi_ok) && (js_cb != NULL)) {
+    status = napi_create_reference(env, js_cb, 1, &dispatcher->js_cb);
+  }
+  if (status != napi_ok) {
+    free(dispatcher);
+    return status;
+  }
+
+  // Convert the callback retrieved from JavaScript into a thread-safe function (tsfn) 
+  // which we can call from a worker thread.
+  status = napi_create_threadsafe_function(
+      env,
+      js_cb,
+      NULL,
+      work_name,
+      0,
+      1,
+      dispatcher,
+      finalize_dispatcher,
+      NULL,
+      call_js,
+      &dispatcher->tsfn);
+  if (status != napi_ok) {
+    free(dispatcher);
+    return status;
+  }
+
+  *result = dispatcher;
+  return napi_ok;
+}
+
+
+/**
+ * Deliver 'data' to the dispatcher's marshaller.
+ *
+ * The C-SDK runs on Node's loop, so its callbacks normally arrive on the JS thread with no JS
+ * on the stack. Those are handed to JS right away, inside a handle scope and a callback scope
+ * (which, like napi_make_callback, drains the microtask and nextTick queues on the way out).
+ * Only calls from another thread, or made while JS is calling into the addon, take the tsfn.
+ */
+napi_status dispatch_to_js(Dispatcher* dispatcher, void* data) {
+  uv_thread_t self = uv_thread_self();
+
+  if (!uv_thread_equal(&self, &dispatcher->thread) || (native_call_depth > 0)) {
+    return napi_call_threadsafe_function(dispatcher->tsfn, data, napi_tsfn_blocking);
+  }
+
+  napi_env env = dispatcher->env;
+  napi_status status;
+  napi_handle_scope handle_scope;
+  napi_callback_scope callback_scope;
+  napi_value resource, js_cb = NULL;
+
+  status = napi_open_handle_scope(env, &handle_scope);
+  if (status != napi_ok) {
+    return napi_call_threadsafe_function(dispatcher->tsfn, data, napi_tsfn_blocking);
+  }
+
+  status = napi_get_reference_value(env, dispatcher->resource, &resource);
+  if ((status == napi_ok) && (dispatcher->js_cb != NULL)) {
+    status = napi_get_reference_value(env, dispatcher->js_cb, &js_cb);
+  }
+  if (status == napi_ok) {
+    status = napi_open_callback_scope(env, resource, dispatcher->async_context, &callback_scope);
+  }
+  if (status != napi_ok) {
+    napi_close_handle_scope(env, handle_scope);
+    return napi_call_threadsafe_function(dispatcher->tsfn, data, napi_tsfn_blocking);
+  }
+
+  dispatcher->call_js(env, js_cb, NULL, data);
+
+  // Report a throwing callback the way a tsfn call would: as an uncaught exception
+  bool pending = false;
+  napi_is_exception_pending(env, &pending);
+  if (pending) {
+    napi_value exception;
+    napi_get_and_clear_last_exception(env, &exception);
+    napi_fatal_exception(env, exception);
+  }
+
+  napi_close_callback_scope(env, callback_scope);
+  napi_close_handle_scope(env, handle_scope);
+
+  return napi_ok;
+}
+
+
+/**
+ * Drop the dispatcher. Calls already queued on its tsfn are still delivered before it is freed.
+ */
+void release_dispatcher(Dispatcher* dispatcher) {
+  napi_release_threadsafe_function(dispatcher->tsfn, napi_tsfn_release);
+}
@@ -32,6 +32,10 @@ static napi_value _ziti_ext_auth_token(napi_env env, const napi_callback_info in
 
     ZITI_NODEJS_LOG(DEBUG, "ziti_ext_auth_token called");
 
+    if (reject_on_net_thread(env, "extAuthToken")) {
+        return NULL;
+    }
+
     // Check if context is initialized
     if (ztx == NULL) {
         ZITI_NODEJS_LOG(ERROR, "ziti context not initialized");
@@ -0,0 +1,229 @@
+/*
+Copyright NetFoundry Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ziti-nodejs.h"
+
+
+/**
+ * Whether inbound data on this connection may be handed to JS right now.
+ *
+ * When it may not, the data callbacks report nothing consumed and mark the connection 'refused'; the C-SDK
+ * keeps the data and stops acknowledging it (so the sender is throttled). It is not relied on to retry by
+ * itself: once the connection may accept data again (resumed, a higher high water mark, or JS caught up),
+ * redeliver_refused_data tells it to flush, and it offers the data again.
+ */
+bool conn_accepts_data(ConnAddonData* addon_data) {
+  if (addon_data->paused) {
+    return false;
+  }
+  return (addon_data->undelivered_bytes < addon_data->high_water_mark);
+}
+
+
+/**
+ * Runs on the thread that owns the connection: ask the C-SDK to offer refused data again, if it now fits
+ */
+static void redeliver_refused_data(ConnAddonData* addon_data) {
+  if (!addon_data->refused || addon_data->closed || (addon_data->conn == NULL) || !conn_accepts_data(addon_data)) {
+    return;
+  }
+  addon_data->refused = false;
+  ZITI_NODEJS_LOG(DEBUG, "redelivering refused data, conn: %p", addon_data->conn);
+  ziti_conn_flush(addon_data->conn);
+}
+
+
+// What a queued flow-control command does to its connection
+typedef enum {
+  FLOW_PAUSE,
+  FLOW_RESUME,
+  FLOW_SET_HIGH_WATER_MARK
+} FlowOp;
+
+// A flow-control change on its way to the thread that owns the connection
+typedef struct FlowItem {
+  ziti_connection conn;
+  ConnAddonData *addon_data;  // for data_delivered_command
+  FlowOp op;
+  size_t value;
+} FlowItem;
+
+
+static void apply_flow_op(ConnAddonData* addon_data, FlowOp op, size_t value) {
+  switch (op) {
+    case FLOW_PAUSE:
+      ZITI_NODEJS_LOG(DEBUG, "pausing addon_data: %p", addon_data);
+      addon_data->paused = true;
+      break;
+    case FLOW_RESUME:
+      ZITI_NODEJS_LOG(DEBUG, "resuming addon_data: %p", addon_data);
+      addon_data->paused = false;
+      break;
+    case FLOW_SET_HIGH_WATER_MARK:
+      ZITI_NODEJS_LOG(DEBUG, "addon_data: %p, high_water_mark: %zu", addon_data, value);
+      addon_data->high_water_mark = value;
+      break;
+  }
+  redeliver_refused_data(addon_data);
+}
+
+
+/**
+ * Runs on the network thread: the connection may have closed since JS asked, in which case there is nothing to do
+ */
+static void flow_op_command(void* arg) {
+  FlowItem* item = (FlowItem*)arg;
+
+  ConnAddonData* addon_data = (ConnAddonData*) ziti_conn_data(item->conn);
+  if (addon_data != NULL) {
+    apply_flow_op(addon_data, item->op, item->value);
+  }
+
+  free(item);
+}
+
+
+static void data_delivered_command(void* arg) {
+  FlowItem* item = (FlowItem*)arg;
+
+  item->addon_data->undelivered_bytes -= item->value;
+  redeliver_refused_data(item->addon_data);
+  release_conn_addon_data(item->addon_data);
+
+  free(item);
+}
+
+
+/**
+ * Called from the on_data marshallers once JS has been handed 'bytes' of a connection's inbound data.
+ * The accounting belongs to the thread that runs the C-SDK, so it is forwarded there if need be.
+ */
+void conn_data_delivered(ConnAddonData* addon_data, size_t bytes) {
+
+  if (!net_thread_enabled()) {
+    addon_data->undelivered_bytes -= bytes;
+    redeliver_refused_data(addon_data);
+    release_conn_addon_data(addon_data);
+    return;
+  }
+
+  FlowItem* item = calloc(1, sizeof(*item));
+  item->addon_data = addon_data;
+  item->value = bytes;
+  run_on_ziti_thread(data_delivered_command, item);
+}
+
+
+/**
+ * Apply a flow-control change requested by JS to the connection in args[0]
+ */
+static napi_value flow_op(napi_env env, size_t argc, napi_value* args, FlowOp op, size_t value) {
+
+  if (argc < 1) {
+    napi_throw_error(env, "EINVAL", "Too few arguments");
+    return NULL;
+  }
+
+  // Obtain ziti_connection
+  int64_t js_conn;
+  if (napi_get_value_int64(env, args[0], &js_conn) != napi_ok) {
+    napi_throw_error(env, NULL, "Failed to get Conn");
+    return NULL;
+  }
+  ziti_connection conn = (ziti_connection)js_conn;
+
+  // The connection belongs to the network thread; hand the change over to it
+  if (net_thread_enabled()) {
+    FlowItem* item = calloc(1, sizeof(*item));
+    item->conn = conn;
+    item->op = op;
+    item->value = value;
+    run_on_ziti_thread(flow_op_command, item);
+  }
+  else {
+    ConnAddonData* addon_data = (ConnAddonData*) ziti_conn_data(conn);
+    if (addon_data == NULL) {
+      napi_throw_error(env, "EINVAL", "connection is closed");
+      return NULL;
+    }
+    apply_flow_op(addon_data, op, value);
+  }
+
+  NAPI_UNDEFINED(env, undefined);
+  return undefined;
+}
+
+
+/**
+ * Stop delivering inbound data on a connection until ziti_resume is called
+ *
+ * @param {number} [0] conn
+ */
+static napi_value _ziti_pause(napi_env env, const napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+
+  NAPI_CHECK(env, "parse arguments", napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+  return flow_op(env, argc, args, FLOW_PAUSE, 0);
+}
+
+
+/**
+ * Resume delivering inbound data on a connection paused by ziti_pause
+ *
+ * @param {number} [0] conn
+ */
+static napi_value _ziti_resume(napi_env env, const napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+
+  NAPI_CHECK(env, "parse arguments", napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+  return flow_op(env, argc, args, FLOW_RESUME, 0);
+}
+
+
+/**
+ * Set how many inbound bytes may be queued for JS on a connection before native stops accepting more
+ *
+ * @param {number} [0] conn
+ * @param {number} [1] highWaterMark (bytes)
+ */
+static napi_value _ziti_set_high_water_mark(napi_env env, const napi_callback_info info) {
+  size_t argc = 2;
+  napi_value args[2];
+
+  NAPI_CHECK(env, "parse arguments", napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+  if (argc < 2) {
+    napi_throw_error(env, "EINVAL", "Too few arguments");
+    return NULL;
+  }
+
+  int64_t hwm;
+  if ((napi_get_value_int64(env, args[1], &hwm) != napi_ok) || (hwm <= 0)) {
+    napi_throw_error(env, "EINVAL", "highWaterMark must be a positive number");
+    return NULL;
+  }
+
+  return flow_op(env, argc, args, FLOW_SET_HIGH_WATER_MARK, (size_t)hwm);
+}
+
+
+ZNODE_EXPOSE(ziti_pause, _ziti_pause)
+ZNODE_EXPOSE(ziti_resume, _ziti_resume)
+ZNODE_EXPOSE(ziti_set_high_water_mark, _ziti_set_high_water_mark)
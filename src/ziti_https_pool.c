@@ -0,0 +1,373 @@
+/*
+Copyright NetFoundry Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ziti-nodejs.h"
+#include <string.h>
+
+
+// Open-addressing (linear probing) table of client pools, keyed by scheme_host_port.
+// It doubles whenever it would become more than half full, so there is no limit on the number of targets.
+// Pools are never removed; only the loop thread touches the table.
+#define HTTPS_POOL_TABLE_MIN_SIZE 64
+
+static HttpsClientPool** pool_table = NULL;
+static size_t pool_table_size = 0;
+static size_t pool_count = 0;
+
+// Settings given to pools as they are created (see ziti_set_https_pool_config)
+static HttpsPoolConfig default_pool_config = {
+  ZITI_NODEJS_HTTPS_POOL_MIN_IDLE,
+  ZITI_NODEJS_HTTPS_POOL_MAX_CLIENTS,
+  ZITI_NODEJS_HTTPS_POOL_IDLE_TIMEOUT_MS
+};
+
+
+// FNV-1a
+static uint32_t hash_key(const char* key) {
+  uint32_t hash = 2166136261u;
+  for (const unsigned char* p = (const unsigned char*)key; *p != '\0'; p++) {
+    hash ^= *p;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+
+static size_t find_slot(HttpsClientPool** table, size_t size, const char* key, uint32_t hash) {
+  size_t mask = size - 1;
+  size_t i = hash & mask;
+  while ((table[i] != NULL) && ((table[i]->hash != hash) || (strcmp(table[i]->scheme_host_port, key) != 0))) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+
+static void grow_pool_table() {
+  size_t size = (pool_table_size == 0) ? HTTPS_POOL_TABLE_MIN_SIZE : (pool_table_size * 2);
+  HttpsClientPool** table = calloc(size, sizeof(HttpsClientPool*));
+
+  for (size_t i = 0; i < pool_table_size; i++) {
+    HttpsClientPool* pool = pool_table[i];
+    if (pool != NULL) {
+      table[find_slot(table, size, pool->scheme_host_port, pool->hash)] = pool;
+    }
+  }
+
+  free(pool_table);
+  pool_table = table;
+  pool_table_size = size;
+
+  ZITI_NODEJS_LOG(DEBUG, "client pool table resized to %zu slots, pools: %zu", size, pool_count);
+}
+
+
+/**
+ * Find the client pool for a scheme_host_port, optionally creating an (empty) one if there is none yet
+ */
+HttpsClientPool* get_https_client_pool(const char* scheme_host_port, bool create) {
+
+  if (create && ((pool_count + 1) * 2 > pool_table_size)) {
+    grow_pool_table();
+  }
+
+  if (pool_table_size == 0) {
+    return NULL;
+  }
+
+  uint32_t hash = hash_key(scheme_host_port);
+  size_t i = find_slot(pool_table, pool_table_size, scheme_host_port, hash);
+
+  if ((pool_table[i] == NULL) && create) {
+    HttpsClientPool* pool = calloc(1, sizeof(*pool));
+    pool->scheme_host_port = strdup(scheme_host_port);
+    pool->hash = hash;
+    pool->config = default_pool_config;
+    pool_table[i] = pool;
+    pool_count++;
+    ZITI_NODEJS_LOG(DEBUG, "created client pool for %s, pools: %zu", scheme_host_port, pool_count);
+  }
+
+  return pool_table[i];
+}
+
+
+// Clients that have been taken out of their pool, to be closed on the next loop iteration.
+// Closing from inside a tlsuv callback (where errors and releases are noticed) is not safe.
+static HttpsClient* closing_clients = NULL;
+static uv_idle_t closing_idle;
+static bool closing_idle_initialized = false;
+
+// Clients closed (or about to be) whose memory tlsuv has not yet let go of
+static size_t draining_count = 0;
+
+
+static void on_https_client_closed(tlsuv_http_t* client) {
+  HttpsClient* httpsClient = (HttpsClient*)client->data;
+  ZITI_NODEJS_LOG(DEBUG, "client [%p] closed, draining: %zu", httpsClient, draining_count - 1);
+  draining_count--;
+  free(httpsClient);
+}
+
+
+static void on_closing_idle(uv_idle_t* handle) {
+  HttpsClient* httpsClient = closing_clients;
+  closing_clients = NULL;
+  uv_idle_stop(handle);
+
+  while (httpsClient != NULL) {
+    HttpsClient* next = httpsClient->next_idle;
+    httpsClient->client.data = httpsClient;
+    tlsuv_http_close(&httpsClient->client, on_https_client_closed);
+    httpsClient = next;
+  }
+}
+
+
+/**
+ * Take a client that has no request in progress out of its pool, close it, and free it once tlsuv is
+ * done with it (which may be after requests it failed have finished unwinding).
+ */
+void close_https_client(HttpsClient* httpsClient) {
+  ZITI_NODEJS_LOG(DEBUG, "closing client [%p] of %s", httpsClient, httpsClient->scheme_host_port);
+
+  httpsClient->pool->client_count--;
+  httpsClient->draining = true;
+  draining_count++;
+
+  if (!closing_idle_initialized) {
+    uv_idle_init(thread_loop, &closing_idle);
+    closing_idle_initialized = true;
+  }
+  httpsClient->next_idle = closing_clients;
+  closing_clients = httpsClient;
+  uv_idle_start(&closing_idle, on_closing_idle);
+}
+
+
+/**
+ * Close the clients that have sat idle for longer than the pool's idle timeout, keeping min_idle of them.
+ * The idle list is most recently used first, so the ones to evict are at its end.
+ */
+static void on_idle_timer(uv_timer_t* handle) {
+  HttpsClientPool* pool = (HttpsClientPool*)handle->data;
+  uint64_t now = uv_now(thread_loop);
+  uint64_t next_expiry = 0;
+
+  HttpsClient** link = &pool->idle;
+  size_t position = 0;
+  while (*link != NULL) {
+    HttpsClient* httpsClient = *link;
+    uint64_t expiry = httpsClient->idle_since + pool->config.idle_timeout_ms;
+
+    if ((position >= pool->config.min_idle) && (expiry <= now)) {
+      *link = httpsClient->next_idle;
+      pool->idle_count--;
+      close_https_client(httpsClient);
+      continue;
+    }
+
+    if ((position >= pool->config.min_idle) && ((next_expiry == 0) || (expiry < next_expiry))) {
+      next_expiry = expiry;
+    }
+    link = &httpsClient->next_idle;
+    position++;
+  }
+
+  if (next_expiry != 0) {
+    uv_timer_start(handle, on_idle_timer, next_expiry - now, 0);
+  }
+}
+
+
+/**
+ * Put a client that has finished its request on its pool's idle list, or close it if the pool is over its limit
+ */
+void push_idle_https_client(HttpsClientPool* pool, HttpsClient* httpsClient) {
+
+  if (pool->client_count > pool->config.max_clients) {
+    close_https_client(httpsClient);
+    return;
+  }
+
+  httpsClient->idle_since = uv_now(thread_loop);
+  httpsClient->next_idle = pool->idle;
+  pool->idle = httpsClient;
+  pool->idle_count++;
+
+  if ((pool->config.idle_timeout_ms == 0) || (pool->idle_count <= pool->config.min_idle)) {
+    return;
+  }
+
+  if (pool->idle_timer == NULL) {
+    pool->idle_timer = calloc(1, sizeof(uv_timer_t));
+    uv_timer_init(thread_loop, pool->idle_timer);
+    pool->idle_timer->data = pool;
+    // Idle clients alone should not keep the process alive
+    uv_unref((uv_handle_t*)pool->idle_timer);
+  }
+
+  if (!uv_is_active((uv_handle_t*)pool->idle_timer)) {
+    uv_timer_start(pool->idle_timer, on_idle_timer, pool->config.idle_timeout_ms, 0);
+  }
+}
+
+
+HttpsClient* pop_idle_https_client(HttpsClientPool* pool) {
+  HttpsClient* httpsClient = pool->idle;
+  if (httpsClient != NULL) {
+    pool->idle = httpsClient->next_idle;
+    httpsClient->next_idle = NULL;
+    pool->idle_count--;
+  }
+  return httpsClient;
+}
+
+
+static bool get_config_uint(napi_env env, napi_value js_config, const char* name, int64_t max, int64_t* value) {
+  bool has;
+  napi_value js_value;
+
+  if ((napi_has_named_property(env, js_config, name, &has) != napi_ok) || !has) {
+    return true;
+  }
+  if (napi_get_named_property(env, js_config, name, &js_value) != napi_ok) {
+    return false;
+  }
+
+  napi_valuetype valuetype;
+  napi_typeof(env, js_value, &valuetype);
+  if (valuetype == napi_undefined) {
+    return true;
+  }
+
+  if ((napi_get_value_int64(env, js_value, value) != napi_ok) || (*value < 0) || (*value > max)) {
+    napi_throw_error(env, "EINVAL", "pool settings must be non-negative numbers");
+    return false;
+  }
+  return true;
+}
+
+
+/**
+ * Apply the settings present in a JS object { minIdle, maxClients, idleTimeoutMs } to 'config'.
+ * Absent settings are left as they are. Throws, and returns false, if a setting is invalid.
+ */
+bool get_https_pool_config(napi_env env, napi_value js_config, HttpsPoolConfig* config) {
+  int64_t min_idle = config->min_idle;
+  int64_t max_clients = config->max_clients;
+  int64_t idle_timeout_ms = (int64_t)config->idle_timeout_ms;
+
+  napi_valuetype valuetype;
+  if ((napi_typeof(env, js_config, &valuetype) != napi_ok) || (valuetype != napi_object)) {
+    napi_throw_error(env, "EINVAL", "pool settings must be an object");
+    return false;
+  }
+
+  if (!get_config_uint(env, js_config, "minIdle", UINT32_MAX, &min_idle) ||
+      !get_config_uint(env, js_config, "maxClients", UINT32_MAX, &max_clients) ||
+      !get_config_uint(env, js_config, "idleTimeoutMs", INT64_MAX, &idle_timeout_ms)) {
+    return false;
+  }
+
+  if (max_clients < 1) {
+    napi_throw_error(env, "EINVAL", "maxClients must be at least 1");
+    return false;
+  }
+
+  config->min_idle = (uint32_t)min_idle;
+  config->max_clients = (uint32_t)max_clients;
+  config->idle_timeout_ms = (uint64_t)idle_timeout_ms;
+  return true;
+}
+
+
+/**
+ * Set the client pool settings used for every scheme_host_port (including pools that already exist)
+ *
+ * @param {object} [0] config  { minIdle, maxClients, idleTimeoutMs }; absent settings are unchanged
+ */
+static napi_value _ziti_set_https_pool_config(napi_env env, const napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+
+  NAPI_CHECK(env, "parse arguments", napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+  if (argc < 1) {
+    napi_throw_error(env, "EINVAL", "Too few arguments");
+    return NULL;
+  }
+
+  HttpsPoolConfig config = default_pool_config;
+  if (!get_https_pool_config(env, args[0], &config)) {
+    return NULL;
+  }
+  default_pool_config = config;
+
+  for (size_t i = 0; i < pool_table_size; i++) {
+    if (pool_table[i] != NULL) {
+      pool_table[i]->config = config;
+    }
+  }
+
+  ZITI_NODEJS_LOG(DEBUG, "minIdle: %u, maxClients: %u, idleTimeoutMs: %llu",
+                  config.min_idle, config.max_clients, (unsigned long long)config.idle_timeout_ms);
+
+  NAPI_UNDEFINED(env, undefined);
+  return undefined;
+}
+
+ZNODE_EXPOSE(ziti_set_https_pool_config, _ziti_set_https_pool_config)
+
+
+/**
+ * Counts across every client pool
+ *
+ * @returns {object} { pools, clients, idleClients, waitingRequests, drainingClients }
+ */
+static napi_value _ziti_https_pool_stats(napi_env env, const napi_callback_info info) {
+  size_t clients = 0, idle = 0, waiting = 0;
+
+  for (size_t i = 0; i < pool_table_size; i++) {
+    HttpsClientPool* pool = pool_table[i];
+    if (pool == NULL) {
+      continue;
+    }
+    clients += pool->client_count;
+    idle += pool->idle_count;
+    for (HttpsAddonData* waiter = pool->waiters_head; waiter != NULL; waiter = waiter->next_waiter) {
+      waiting++;
+    }
+  }
+
+  napi_value stats, value;
+  NAPI_CHECK(env, "create stats", napi_create_object(env, &stats));
+
+  napi_create_int64(env, (int64_t)pool_count, &value);
+  napi_set_named_property(env, stats, "pools", value);
+  napi_create_int64(env, (int64_t)clients, &value);
+  napi_set_named_property(env, stats, "clients", value);
+  napi_create_int64(env, (int64_t)idle, &value);
+  napi_set_named_property(env, stats, "idleClients", value);
+  napi_create_int64(env, (int64_t)waiting, &value);
+  napi_set_named_property(env, stats, "waitingRequests", value);
+  napi_create_int64(env, (int64_t)draining_count, &value);
+  napi_set_named_property(env, stats, "drainingClients", value);
+
+  return stats;
+}
+
+ZNODE_EXPOSE(ziti_https_pool_stats, _ziti_https_pool_stats)
@@ -26,6 +26,8 @@ typedef struct OnClientItem {
   char *caller_id;
   uint8_t *app_data;
   size_t app_data_sz;
+  ConnAddonData *conn_data;   // set when app_data is counted against the client's undelivered bytes
+  bool closed;                // the client connection was closed here (on error), so JS must not close it again
 
 } OnClientItem;
 
@@ -51,7 +53,6 @@ static void CallJs_on_listen_client_data(napi_env env, napi_value js_cb, void* c
 
     // const obj = {}
     napi_value undefined, js_client_item, js_client, js_buffer, js_arb_data;
-    void* result_data;
 
     // Retrieve the JavaScript `undefined` value so we can use it as the `this`
     // value of the JavaScript function call.
@@ -93,7 +94,9 @@ static void CallJs_on_listen_client_data(napi_env env, napi_value js_cb, void* c
 
     // js_client_item.app_data = app_data
     if (NULL != item->app_data) {
-      rc = napi_create_buffer_copy(env, item->app_data_sz, (const void*)item->app_data, (void**)&result_data, &js_buffer);
+      // The Buffer takes ownership of item->app_data, so it is not copied a second time
+      rc = create_external_buffer(env, item->app_data, item->app_data_sz, &js_buffer);
+      item->app_data = NULL;
       if (rc != napi_ok) {
         napi_throw_error(env, "EINVAL", "failure to create js_client_item.app_data");
       }
@@ -104,9 +107,17 @@ static void CallJs_on_listen_client_data(napi_env env, napi_value js_cb, void* c
     } else {
       rc = napi_set_named_property(env, js_client_item, "app_data", undefined);
     }
-    ZITI_NODEJS_LOG(DEBUG, "app_data: %p", item->app_data);
-
 
+    // js_client_item.closed = closed
+    napi_value js_closed;
+    rc = napi_get_boolean(env, item->closed, &js_closed);
+    if (rc != napi_ok) {
+      napi_throw_error(env, "EINVAL", "failure to create js_client_item.closed");
+    }
+    rc = napi_set_named_property(env, js_client_item, "closed", js_closed);
+    if (rc != napi_ok) {
+      napi_throw_error(env, "EINVAL", "failure to set named property closed");
+    }
     ZITI_NODEJS_LOG(INFO, "calling JS on_listen_client_data callback...");
 
     // Call the JavaScript function and pass it the data
@@ -124,22 +135,40 @@ static void CallJs_on_listen_client_data(napi_env env, napi_value js_cb, void* c
 
   }
 
+  // The bytes are JS's now; this may let the C-SDK resume flushing to us
+  if (item->conn_data != NULL) {
+    conn_data_delivered(item->conn_data, item->app_data_sz);
+  }
+
+  free(item->app_data);
+  free(item);
 }
 
 static ssize_t on_listen_client_data(ziti_connection client, const uint8_t *data, ssize_t len) {
 
   ZITI_NODEJS_LOG(DEBUG, "on_listen_client_data: client: %p, data: %p, len: %zd", client, data, len);
 
-  ListenAddonData* addon_data = (ListenAddonData*) ziti_conn_data(client);
+  ConnAddonData* conn_data = (ConnAddonData*) ziti_conn_data(client);
+  ListenAddonData* addon_data = conn_data->listener;
+
+  // Leave the data with the C-SDK (which applies backpressure on the circuit) while JS is not keeping up
+  if ((len > 0) && !conn_accepts_data(conn_data)) {
+    ZITI_NODEJS_LOG(DEBUG, "deferring %zd bytes, client: %p, paused: %d, undelivered: %zu", len, client, conn_data->paused, conn_data->undelivered_bytes);
+    conn_data->refused = true;
+    return 0;
+  }
 
   OnClientItem* item = memset(malloc(sizeof(*item)), 0, sizeof(*item));
   item->client = client;
   item->js_arb_data = addon_data->js_arb_data;
 
   if ((NULL != data) && ((len > 0))) {
-    item->app_data = calloc(1, len + 1);
-    memcpy((void*)item->app_data, data, len);
+    // This is the only copy made on the inbound path; the C-SDK reuses 'data' once we return
+    item->app_data = malloc(len);
+    memcpy(item->app_data, data, len);
     item->app_data_sz = len;
+    item->conn_data = conn_data;
+    conn_data->undelivered_bytes += len;
   }
 
   if (len > 0) {
@@ -151,18 +180,23 @@ static ssize_t on_listen_client_data(ziti_connection client, const uint8_t *data
   }
   else {
       ZITI_NODEJS_LOG(ERROR, "on_listen_client_data: error: %zd(%s)", len, ziti_errorstr(len));
-      ziti_close(client, NULL);
+      item->closed = true;
+      ziti_close(client, on_ziti_conn_close);
   }
   
   // Initiate the call into the JavaScript callback. 
-  // The call into JavaScript will not have happened 
-  // when this function returns, but it will be queued.
-  napi_status nstatus = napi_call_threadsafe_function(
-      addon_data->tsfn_on_listen_client_data,        
-      item,  // Send the status we received over to the JS callback
-      napi_tsfn_blocking);
+  // The call into JavaScript has either happened already
+  // when this function returns, or it has been queued.
+  napi_status nstatus = dispatch_to_js(
+      addon_data->on_listen_client_data,
+      item);  // Send the status we received over to the JS callback
   if (nstatus != napi_ok) {
-    ZITI_NODEJS_LOG(ERROR, "Unable to napi_call_threadsafe_function");
+    ZITI_NODEJS_LOG(ERROR, "Unable to dispatch_to_js");
+    if (item->conn_data != NULL) {
+      conn_data->undelivered_bytes -= item->app_data_sz;
+    }
+    free(item->app_data);
+    free(item);
   }
 
   return len;
@@ -267,7 +301,8 @@ static void on_listen_client_connect(ziti_connection client, int status) {
 
   ZITI_NODEJS_LOG(DEBUG, "on_listen_client_connect: client: %p, status: %d", client, status);
 
-  ListenAddonData* addon_data = (ListenAddonData*) ziti_conn_data(client);
+  ConnAddonData* conn_data = (ConnAddonData*) ziti_conn_data(client);
+  ListenAddonData* addon_data = conn_data->listener;
 
   OnClientItem* item = memset(malloc(sizeof(*item)), 0, sizeof(*item));
   item->status = status;
@@ -275,14 +310,13 @@ static void on_listen_client_connect(ziti_connection client, int status) {
   item->js_arb_data = addon_data->js_arb_data;
 
   // Initiate the call into the JavaScript callback. 
-  // The call into JavaScript will not have happened 
-  // when this function returns, but it will be queued.
-  napi_status nstatus = napi_call_threadsafe_function(
-      addon_data->tsfn_on_listen_client_connect,        
-      item,  // Send the status we received over to the JS callback
-      napi_tsfn_blocking);
+  // The call into JavaScript has either happened already
+  // when this function returns, or it has been queued.
+  napi_status nstatus = dispatch_to_js(
+      addon_data->on_listen_client_connect,
+      item);  // Send the status we received over to the JS callback
   if (nstatus != napi_ok) {
-    ZITI_NODEJS_LOG(ERROR, "Unable to napi_call_threadsafe_function");
+    ZITI_NODEJS_LOG(ERROR, "Unable to dispatch_to_js");
   }
 
 }
@@ -483,7 +517,13 @@ void on_listen_client(ziti_connection serv, ziti_connection client, int status,
 
   if (status == ZITI_OK) {
 
-    ziti_conn_set_data(client, addon_data);
+    // Each accepted client gets its own connection data, sharing the listener's dispatchers
+    ConnAddonData* conn_data = calloc(1, sizeof(*conn_data));
+    conn_data->listener = addon_data;
+    conn_data->on_write = addon_data->on_write;
+    conn_data->high_water_mark = ZITI_NODEJS_DEFAULT_HIGH_WATER_MARK;
+    conn_data->conn = client;
+    ziti_conn_set_data(client, conn_data);
 
     const char *source_identity = clt_ctx->caller_id;
     if (source_identity != NULL) {
@@ -514,14 +554,13 @@ void on_listen_client(ziti_connection serv, ziti_connection client, int status,
   }
 
   // Initiate the call into the JavaScript callback. 
-  // The call into JavaScript will not have happened 
-  // when this function returns, but it will be queued.
-  nstatus = napi_call_threadsafe_function(
-      addon_data->tsfn_on_listen_client,        
-      item,  // Send the client ctx we received over to the JS callback
-      napi_tsfn_blocking);
+  // The call into JavaScript has either happened already
+  // when this function returns, or it has been queued.
+  nstatus = dispatch_to_js(
+      addon_data->on_listen_client,
+      item);  // Send the client ctx we received over to the JS callback
   if (nstatus != napi_ok) {
-    ZITI_NODEJS_LOG(ERROR, "Unable to napi_call_threadsafe_function");
+    ZITI_NODEJS_LOG(ERROR, "Unable to dispatch_to_js");
   }
   
 }
@@ -544,18 +583,48 @@ void on_listen(ziti_connection serv, int status) {
   }
 
   // Initiate the call into the JavaScript callback. 
-  // The call into JavaScript will not have happened 
-  // when this function returns, but it will be queued.
-  nstatus = napi_call_threadsafe_function(
-      addon_data->tsfn_on_listen,
-      (void*)(int64_t)status,   // Send the status over to the JS callback
-      napi_tsfn_blocking);
+  // The call into JavaScript has either happened already
+  // when this function returns, or it has been queued.
+  nstatus = dispatch_to_js(
+      addon_data->on_listen,
+      (void*)(int64_t)status);  // Send the status over to the JS callback
   if (nstatus != napi_ok) {
-    ZITI_NODEJS_LOG(ERROR, "Unable to napi_call_threadsafe_function");
+    ZITI_NODEJS_LOG(ERROR, "Unable to dispatch_to_js");
   }
 }
 
 
+/**
+ * Init the server connection and start listening. Runs on the thread that owns the ziti_context.
+ */
+static void listen_command(void* arg) {
+  ListenAddonData* addon_data = (ListenAddonData*)arg;
+
+  // Init a Ziti connection object, and attach our add-on data to it so we can 
+  // pass context around between our callbacks, as propagate it all the way out
+  // to the JavaScript callbacks
+  int rc = ziti_conn_init(ztx, &addon_data->server, addon_data);
+  if (rc != ZITI_OK) {
+    ZITI_NODEJS_LOG(ERROR, "failure in ziti_conn_init: %d", rc);
+
+    // Report the failure through the 'listen' callback
+    if (dispatch_to_js(addon_data->on_listen, (void*)(int64_t)rc) != napi_ok) {
+      ZITI_NODEJS_LOG(ERROR, "Unable to dispatch_to_js");
+    }
+    return;
+  }
+
+  // Start listening
+  ZITI_NODEJS_LOG(DEBUG, "calling ziti_listen_with_options: %p, addon_data: %p", ztx, addon_data);
+  ziti_listen_opts listen_opts = {
+    .bind_using_edge_identity = false,
+  };
+
+  ziti_listen_with_options(addon_data->server, addon_data->service_name, &listen_opts, on_listen, on_listen_client);
+  // ziti_listen_with_options(addon_data->server, ServiceName, NULL, on_listen, on_listen_client);
+}
+
+
 /**
  * 
  */
@@ -594,149 +663,42 @@ napi_value _ziti_listen(napi_env env, const napi_callback_info info) {
   addon_data->js_arb_data = js_arb_data;
   ZITI_NODEJS_LOG(DEBUG, "js_arb_data: %lld", (long long)js_arb_data);
 
-  // Obtain ptr to JS 'on_listen' callback function
+  // Obtain ptrs to the JS callback functions, and create the dispatchers that deliver into them
   napi_value js_on_listen = args[2];
-  napi_value work_name_listen;
-
-  // Create a string to describe this asynchronous operation.
-  status = napi_create_string_utf8(
-    env,
-    "N-API on_listen",
-    NAPI_AUTO_LENGTH,
-    &work_name_listen);
-  if (status != napi_ok) {
-    napi_throw_error(env, NULL, "Unable to napi_create_string_utf8");
-  }
-
-  // Convert the callback retrieved from JavaScript into a thread-safe function (tsfn) 
-  // which we can call from a worker thread.
-  status = napi_create_threadsafe_function(
-      env,
-      js_on_listen,
-      NULL,
-      work_name_listen,
-      0,
-      1,
-      NULL,
-      NULL,
-      NULL,
-      CallJs_on_listen,
-      &(addon_data->tsfn_on_listen));
+  status = create_dispatcher(env, js_on_listen, "N-API on_listen", CallJs_on_listen, &(addon_data->on_listen));
   if (status != napi_ok) {
-    napi_throw_error(env, NULL, "Unable to napi_create_threadsafe_function");
+    napi_throw_error(env, NULL, "Unable to create_dispatcher");
   }
 
-  // Obtain ptr to JS 'on_listen_client' callback function
   napi_value js_on_listen_client = args[3];
-  napi_value work_name_client;
-
-  // Create a string to describe this asynchronous operation.
-  status = napi_create_string_utf8(
-    env,
-    "N-API on_listen_client",
-    NAPI_AUTO_LENGTH,
-    &work_name_client);
+  status = create_dispatcher(env, js_on_listen_client, "N-API on_listen_client", CallJs_on_listen_client, &(addon_data->on_listen_client));
   if (status != napi_ok) {
-    napi_throw_error(env, NULL, "Unable to napi_create_string_utf8");
+    napi_throw_error(env, NULL, "Unable to create_dispatcher");
   }
 
-  // Convert the callback retrieved from JavaScript into a thread-safe function (tsfn) 
-  // which we can call from a worker thread.
-  status = napi_create_threadsafe_function(
-      env,
-      js_on_listen_client,
-      NULL,
-      work_name_client,
-      0,
-      1,
-      NULL,
-      NULL,
-      NULL,
-      CallJs_on_listen_client,
-      &(addon_data->tsfn_on_listen_client));
-  if (status != napi_ok) {
-    napi_throw_error(env, NULL, "Unable to napi_create_threadsafe_function");
-  }
-
-  // Obtain ptr to JS 'on_listen_client_connect' callback function
   napi_value js_on_listen_client_connect = args[4];
-
-  // Create a string to describe this asynchronous operation.
-  status = napi_create_string_utf8(
-    env,
-    "N-API on_listen_client_connect",
-    NAPI_AUTO_LENGTH,
-    &work_name_client);
-  if (status != napi_ok) {
-    napi_throw_error(env, NULL, "Unable to napi_create_string_utf8");
-  }
-
-  // Convert the callback retrieved from JavaScript into a thread-safe function (tsfn) 
-  // which we can call from a worker thread.
-  status = napi_create_threadsafe_function(
-      env,
-      js_on_listen_client_connect,
-      NULL,
-      work_name_client,
-      0,
-      1,
-      NULL,
-      NULL,
-      NULL,
-      CallJs_on_listen_client_connect,
-      &(addon_data->tsfn_on_listen_client_connect));
+  status = create_dispatcher(env, js_on_listen_client_connect, "N-API on_listen_client_connect", CallJs_on_listen_client_connect, &(addon_data->on_listen_client_connect));
   if (status != napi_ok) {
-    napi_throw_error(env, NULL, "Unable to napi_create_threadsafe_function");
+    napi_throw_error(env, NULL, "Unable to create_dispatcher");
   }
 
-  // Obtain ptr to JS 'on_listen_client_data' callback function
   napi_value js_on_listen_client_data = args[5];
-
-  // Create a string to describe this asynchronous operation.
-  status = napi_create_string_utf8(
-    env,
-    "N-API on_listen_client_data",
-    NAPI_AUTO_LENGTH,
-    &work_name_client);
+  status = create_dispatcher(env, js_on_listen_client_data, "N-API on_listen_client_data", CallJs_on_listen_client_data, &(addon_data->on_listen_client_data));
   if (status != napi_ok) {
-    napi_throw_error(env, NULL, "Unable to napi_create_string_utf8");
+    napi_throw_error(env, NULL, "Unable to create_dispatcher");
   }
 
-  // Convert the callback retrieved from JavaScript into a thread-safe function (tsfn) 
-  // which we can call from a worker thread.
-  status = napi_create_threadsafe_function(
-      env,
-      js_on_listen_client_data,
-      NULL,
-      work_name_client,
-      0,
-      1,
-      NULL,
-      NULL,
-      NULL,
-      CallJs_on_listen_client_data,
-      &(addon_data->tsfn_on_listen_client_data));
+  // Create the write-completion dispatcher once; every client accepted on this listener shares it
+  status = create_on_write_dispatcher(env, &(addon_data->on_write));
   if (status != napi_ok) {
-    napi_throw_error(env, NULL, "Unable to napi_create_threadsafe_function");
+    napi_throw_error(env, NULL, "Unable to create_dispatcher");
   }
 
-  // Init a Ziti connection object, and attach our add-on data to it so we can 
-  // pass context around between our callbacks, as propagate it all the way out
-  // to the JavaScript callbacks
   addon_data->service_name = strdup(ServiceName);
-  int rc = ziti_conn_init(ztx, &addon_data->server, addon_data);
-  if (rc != ZITI_OK) {
-    napi_throw_error(env, NULL, "failure in 'ziti_conn_init");
-  }
 
-  // Start listening
-  ZITI_NODEJS_LOG(DEBUG, "calling ziti_listen_with_options: %p, addon_data: %p", ztx, addon_data);
-  ziti_listen_opts listen_opts = {
-    .bind_using_edge_identity = false,
-  };
-
-  ziti_listen_with_options(addon_data->server, ServiceName, &listen_opts, on_listen, on_listen_client);
-  // ziti_listen_with_options(addon_data->server, ServiceName, NULL, on_listen, on_listen_client);
+  enter_native_call();
+  run_on_ziti_thread(listen_command, addon_data);
+  leave_native_call();
 
   return NULL;
 }
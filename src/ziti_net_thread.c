@@ -0,0 +1,174 @@
+/*
+Copyright NetFoundry Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ziti-nodejs.h"
+
+/**
+ * Optional dedicated network thread.
+ *
+ * By default the ziti_context runs on Node's own loop. When ziti.init asks for a network thread,
+ * it runs on a private uv loop on a thread of its own instead, so TLS, Ziti framing and crypto
+ * stay off the JS thread. JS reaches that thread through a lock-free MPSC command queue; events
+ * come back through the Dispatchers' threadsafe functions, which the JS thread drains in batches.
+ */
+
+// A unit of work queued for the network thread
+typedef struct NetCommand {
+  struct NetCommand *next;
+  void (*run)(void *arg);
+  void *arg;
+} NetCommand;
+
+static uv_loop_t net_loop;
+static uv_thread_t net_thread;
+static uv_async_t net_wakeup;
+static bool net_thread_started = false;     // only ever set, once, on the JS thread
+
+// Producers push onto this stack; the network thread takes the whole stack at once
+static NetCommand *net_commands = NULL;
+
+
+/**
+ * Run every command queued so far, oldest first
+ */
+static void on_net_wakeup(uv_async_t *handle) {
+  (void) handle;
+
+  NetCommand *cmd = ZITI_ATOMIC_XCHG_PTR(&net_commands, NULL);
+
+  // The stack is newest first; reverse it to preserve submission order
+  NetCommand *fifo = NULL;
+  while (cmd != NULL) {
+    NetCommand *next = cmd->next;
+    cmd->next = fifo;
+    fifo = cmd;
+    cmd = next;
+  }
+
+  while (fifo != NULL) {
+    NetCommand *next = fifo->next;
+    fifo->run(fifo->arg);
+    free(fifo);
+    fifo = next;
+  }
+}
+
+
+static void net_thread_main(void *arg) {
+  (void) arg;
+
+  ZITI_NODEJS_LOG(INFO, "network thread running");
+  uv_run(&net_loop, UV_RUN_DEFAULT);
+  ZITI_NODEJS_LOG(INFO, "network thread exiting");
+}
+
+
+/**
+ * Start the network thread. Called from the JS thread; a no-op if it is already running.
+ */
+int start_net_thread(napi_env env) {
+  int rc;
+
+  if (net_thread_started) {
+    return 0;
+  }
+
+  rc = uv_loop_init(&net_loop);
+  if (rc != 0) {
+    return rc;
+  }
+
+  // The wakeup handle also keeps the private loop alive for the life of the process
+  rc = uv_async_init(&net_loop, &net_wakeup, on_net_wakeup);
+  if (rc != 0) {
+    uv_loop_close(&net_loop);
+    return rc;
+  }
+
+  rc = init_closed_write_dispatcher(env);
+  if (rc != napi_ok) {
+    ZITI_NODEJS_LOG(ERROR, "failed to create closed-connection write dispatcher: %d", rc);
+  }
+
+  rc = uv_thread_create(&net_thread, net_thread_main, NULL);
+  if (rc != 0) {
+    return rc;
+  }
+
+  net_thread_started = true;
+  return 0;
+}
+
+
+bool net_thread_enabled(void) {
+  return net_thread_started;
+}
+
+
+/**
+ * The loop the ziti_context (and everything hanging off it) runs on
+ */
+uv_loop_t *get_ziti_loop(void) {
+  return net_thread_started ? &net_loop : thread_loop;
+}
+
+
+/**
+ * Run 'fn(arg)' on the thread that owns the ziti_context: right away if that is this thread,
+ * otherwise by queueing it for the network thread.
+ */
+void run_on_ziti_thread(void (*fn)(void *arg), void *arg) {
+
+  if (!net_thread_started) {
+    fn(arg);
+    return;
+  }
+
+  uv_thread_t self = uv_thread_self();
+  if (uv_thread_equal(&self, &net_thread)) {
+    fn(arg);
+    return;
+  }
+
+  NetCommand *cmd = malloc(sizeof(*cmd));
+  cmd->run = fn;
+  cmd->arg = arg;
+
+  NetCommand *head;
+  do {
+    head = ZITI_ATOMIC_LOAD_PTR(&net_commands);
+    cmd->next = head;
+  } while (!ZITI_ATOMIC_CAS_PTR(&net_commands, head, cmd));
+
+  // uv_async_send coalesces, so a burst of commands costs the network thread one wakeup
+  uv_async_send(&net_wakeup);
+}
+
+
+/**
+ * Throw ENOTSUP for APIs that drive the ziti_context directly from the JS thread,
+ * which is not possible once it runs on the network thread. Returns true if it threw.
+ */
+bool reject_on_net_thread(napi_env env, const char *api) {
+  if (!net_thread_started) {
+    return false;
+  }
+
+  char msg[128];
+  snprintf(msg, sizeof(msg), "%s is not available when ziti runs on its own network thread", api);
+  napi_throw_error(env, "ENOTSUP", msg);
+  return true;
+}
@@ -0,0 +1,124 @@
+/*
+Copyright NetFoundry Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ziti-nodejs.h"
+#include <string.h>
+
+
+// Elements longer than this end the capture; they and the ones after them are not sent
+#define ZITI_NODEJS_MAX_HEADER_ELEMENT_LEN (8*1024)
+
+
+/**
+ * Pack the JS array of "name:value" strings into headers->buf ("name\0value\0...").
+ *
+ * The array is walked twice: once to size the buffer, once to copy each element straight into it
+ * (the first ':' becomes the name's NUL), so there is one allocation whatever the header count.
+ *
+ * Returns 0 on success, 1 if an over-long element cut the headers short, or -1 after throwing a JS error.
+ */
+int capture_request_headers(napi_env env, napi_value js_headers, RequestHeaders *headers) {
+  napi_status status;
+  uint32_t array_len;
+  uint32_t count = 0;
+  size_t buf_len = 0;
+  int truncated = 0;
+
+  headers->count = 0;
+  headers->buf = NULL;
+
+  status = napi_get_array_length(env, js_headers, &array_len);
+  if (status != napi_ok) {
+    napi_throw_error(env, "EINVAL", "Failed to obtain headers array");
+    return -1;
+  }
+  ZITI_NODEJS_LOG(DEBUG, "headers array length: %d", array_len);
+
+  for (uint32_t i = 0; i < array_len; i++) {
+    napi_value element;
+    size_t element_len;
+    status = napi_get_element(env, js_headers, i, &element);
+    if (status != napi_ok) {
+      napi_throw_error(env, "EINVAL", "Failed to obtain headers element");
+      return -1;
+    }
+    status = napi_get_value_string_utf8(env, element, NULL, 0, &element_len);
+    if (status != napi_ok) {
+      napi_throw_error(env, "EINVAL", "header arry element is not a string");
+      return -1;
+    }
+    if (element_len > ZITI_NODEJS_MAX_HEADER_ELEMENT_LEN) {
+      ZITI_NODEJS_LOG(ERROR, "skipping header element %d and beyond; length too long", i);
+      truncated = 1;
+      break;
+    }
+    buf_len += element_len + 1;   // "name:value" -> "name\0value\0"
+    count++;
+  }
+
+  if (count == 0) {
+    return truncated;
+  }
+
+  char* buf = malloc(buf_len);
+  char* p = buf;
+  for (uint32_t i = 0; i < count; i++) {
+    napi_value element;
+    size_t copied;
+    status = napi_get_element(env, js_headers, i, &element);
+    if (status == napi_ok) {
+      status = napi_get_value_string_utf8(env, element, p, (size_t)(buf + buf_len - p), &copied);
+    }
+    if (status != napi_ok) {
+      free(buf);
+      napi_throw_error(env, "EINVAL", "Failed to obtain element");
+      return -1;
+    }
+
+    char* colon = memchr(p, ':', copied);
+    if ((colon == NULL) || (colon == p) || (colon == p + copied - 1)) {
+      free(buf);
+      napi_throw_error(env, "EINVAL", "Failed to split header element");
+      return -1;
+    }
+    *colon = '\0';
+    ZITI_NODEJS_LOG(DEBUG, "header: %s : %s", p, colon + 1);
+    p += copied + 1;
+  }
+
+  headers->count = count;
+  headers->buf = buf;
+  return truncated;
+}
+
+/**
+ * Add the captured headers to an outgoing request (tlsuv copies them)
+ */
+void apply_request_headers(tlsuv_http_req_t *req, const RequestHeaders *headers) {
+  const char* p = headers->buf;
+  for (uint32_t i = 0; i < headers->count; i++) {
+    const char* name = p;
+    const char* value = name + strlen(name) + 1;
+    tlsuv_http_req_header(req, name, value);
+    p = value + strlen(value) + 1;
+  }
+}
+
+void free_request_headers(RequestHeaders *headers) {
+  free(headers->buf);
+  headers->buf = NULL;
+  headers->count = 0;
+}
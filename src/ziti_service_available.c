@@ -127,6 +127,22 @@ static void on_service_available(ziti_context nf_ctx, const ziti_service* servic
   }
 }
 
+// A service lookup queued for the thread that owns the ziti_context
+typedef struct ServiceAvailableRequest {
+  char *service_name;
+  AddonData *addon_data;
+} ServiceAvailableRequest;
+
+static void service_available_command(void *arg) {
+  ServiceAvailableRequest* item = (ServiceAvailableRequest*)arg;
+
+  ziti_service_available(ztx, item->service_name, on_service_available, item->addon_data);
+
+  free(item->service_name);
+  free(item);
+}
+
+
 /**
  * 
  */
@@ -188,7 +204,10 @@ napi_value _ziti_service_available(napi_env env, const napi_callback_info info)
   }
 
   // Now, call the C-SDK to see if the service name is present
-  ziti_service_available(ztx, ServiceName, on_service_available, addon_data);
+  ServiceAvailableRequest* item = malloc(sizeof(*item));
+  item->service_name = strdup(ServiceName);
+  item->addon_data = addon_data;
+  run_on_ziti_thread(service_available_command, item);
 
   status = napi_create_int32(env, 0 /* always succeed here, it is the cb that tells the real tale */, &jsRetval);
   if (status != napi_ok) {
@@ -0,0 +1,321 @@
+/*
+Copyright NetFoundry Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ziti-nodejs.h"
+#include <stdio.h>
+#include <string.h>
+
+
+// Opt-in on-disk copy of the service table (see ziti.init's serviceCache option), so a restarted
+// process can resolve addresses before the controller has sent its first service event.
+//
+// Format: a header line, then one record per service:
+//   "<perm_flags> <name len> <id len> <intercept len> <client len> <zrok len>\n" followed by the
+//   fields' bytes back to back and a "\n". A length of -1 stands for a missing field.
+// Rewritten through a temporary file (owner-only, flushed to disk before it replaces the cache) after
+// every service event, so a crash never leaves half a file. The file work runs on the libuv threadpool,
+// one save at a time; events that arrive meanwhile are folded into a single save of the latest table.
+#define SERVICE_CACHE_HEADER "ziti-nodejs service cache 1\n"
+#define SERVICE_CACHE_FIELDS 5
+
+// Anything bigger is not a file we wrote
+#define SERVICE_CACHE_MAX_SIZE (16 * 1024 * 1024)
+
+static char* cache_path = NULL;
+
+// A save is running on the threadpool / another was asked for while it ran
+static bool save_in_flight = false;
+static bool save_pending = false;
+
+
+static char* read_field(const char** p, long len) {
+  if (len < 0) {
+    return NULL;
+  }
+  char* field = malloc((size_t)len + 1);
+  memcpy(field, *p, (size_t)len);
+  field[len] = '\0';
+  *p += len;
+  return field;
+}
+
+// Parse one record at *p; false when the file is truncated or malformed
+static bool read_record(const char** p, const char* end, ServiceInfo* info) {
+  char* cursor;
+  long perm_flags = strtol(*p, &cursor, 10);
+  long lens[SERVICE_CACHE_FIELDS];
+  long total = 0;
+  for (int i = 0; i < SERVICE_CACHE_FIELDS; i++) {
+    if ((cursor >= end) || (*cursor != ' ')) {
+      return false;
+    }
+    lens[i] = strtol(cursor + 1, &cursor, 10);
+    if ((lens[i] < -1) || (lens[i] > SERVICE_CACHE_MAX_SIZE)) {
+      return false;
+    }
+    total += (lens[i] > 0) ? lens[i] : 0;
+  }
+  if ((cursor >= end) || (*cursor != '\n') || (lens[0] <= 0) || (total + 1 > end - (cursor + 1))) {
+    return false;
+  }
+
+  *p = cursor + 1;
+  info->perm_flags = (int)perm_flags;
+  info->name = read_field(p, lens[0]);
+  info->id = read_field(p, lens[1]);
+  info->intercept_cfg = read_field(p, lens[2]);
+  info->client_cfg = read_field(p, lens[3]);
+  info->zrok_cfg = read_field(p, lens[4]);
+  *p += 1;
+  return true;
+}
+
+/**
+ * Use 'path' as the service cache, and restore the services it holds into the service table
+ * (as provisional) and the hostname index. Returns how many services were restored; a missing or
+ * unreadable cache just restores none.
+ */
+size_t load_service_cache(const char* path) {
+  free(cache_path);
+  cache_path = strdup(path);
+
+  FILE* f = fopen(path, "rb");
+  if (f == NULL) {
+    ZITI_NODEJS_LOG(DEBUG, "no service cache at %s", path);
+    return 0;
+  }
+
+  char* buf = NULL;
+  long size = -1;
+  if ((fseek(f, 0, SEEK_END) == 0) && ((size = ftell(f)) >= 0) && (size <= SERVICE_CACHE_MAX_SIZE) &&
+      (fseek(f, 0, SEEK_SET) == 0)) {
+    buf = malloc((size_t)size + 1);
+    if (fread(buf, 1, (size_t)size, f) != (size_t)size) {
+      size = -1;
+    }
+  }
+  fclose(f);
+
+  size_t restored = 0;
+  size_t header_len = strlen(SERVICE_CACHE_HEADER);
+  if ((buf == NULL) || (size < (long)header_len) || (memcmp(buf, SERVICE_CACHE_HEADER, header_len) != 0)) {
+    ZITI_NODEJS_LOG(WARN, "ignoring unreadable service cache %s", path);
+    free(buf);
+    return 0;
+  }
+  buf[size] = '\0';
+
+  const char* p = buf + header_len;
+  const char* end = buf + size;
+  while (p < end) {
+    ServiceInfo info = {0};
+    if (!read_record(&p, end, &info)) {
+      ZITI_NODEJS_LOG(WARN, "service cache %s is truncated after %zu services", path, restored);
+      break;
+    }
+    track_service_hostnames(&info);
+    restore_service(&info);
+    restored++;
+  }
+  free(buf);
+
+  ZITI_NODEJS_LOG(INFO, "restored %zu services from %s", restored, path);
+  return restored;
+}
+
+
+// The cache's bytes, built in memory before they are written out
+typedef struct CacheBuffer {
+  char* data;
+  size_t len;
+  size_t capacity;
+} CacheBuffer;
+
+static void append(CacheBuffer* buf, const char* bytes, size_t len) {
+  if (buf->len + len > buf->capacity) {
+    size_t capacity = (buf->capacity == 0) ? 4096 : buf->capacity;
+    while (buf->len + len > capacity) {
+      capacity *= 2;
+    }
+    buf->data = realloc(buf->data, capacity);
+    buf->capacity = capacity;
+  }
+  memcpy(buf->data + buf->len, bytes, len);
+  buf->len += len;
+}
+
+static void write_field(CacheBuffer* buf, const char* field) {
+  if (field != NULL) {
+    append(buf, field, strlen(field));
+  }
+}
+
+static long field_len(const char* field) {
+  return (field != NULL) ? (long)strlen(field) : -1;
+}
+
+static void write_record(const ServiceInfo* info, void* ctx) {
+  CacheBuffer* buf = ctx;
+  char line[128];
+  int n = snprintf(line, sizeof(line), "%d %ld %ld %ld %ld %ld\n", info->perm_flags, field_len(info->name),
+                   field_len(info->id), field_len(info->intercept_cfg), field_len(info->client_cfg),
+                   field_len(info->zrok_cfg));
+  append(buf, line, (size_t)n);
+  write_field(buf, info->name);
+  write_field(buf, info->id);
+  write_field(buf, info->intercept_cfg);
+  write_field(buf, info->client_cfg);
+  write_field(buf, info->zrok_cfg);
+  append(buf, "\n", 1);
+}
+
+// Create 'path' readable by the owner only (the configs may be sensitive), write 'buf' to it and
+// flush it to disk. Returns 0 or a libuv error code. Synchronous, so it runs on the threadpool.
+static int write_cache_file(const char* path, const CacheBuffer* buf) {
+  uv_fs_t req;
+
+  // A leftover temporary file would keep whatever mode it was created with
+  uv_fs_unlink(NULL, &req, path, NULL);
+  uv_fs_req_cleanup(&req);
+
+  int fd = uv_fs_open(NULL, &req, path, UV_FS_O_WRONLY | UV_FS_O_CREAT | UV_FS_O_TRUNC, 0600, NULL);
+  uv_fs_req_cleanup(&req);
+  if (fd < 0) {
+    return fd;
+  }
+
+  int rc = 0;
+  size_t written = 0;
+  while ((rc >= 0) && (written < buf->len)) {
+    uv_buf_t chunk = uv_buf_init(buf->data + written, (unsigned int)(buf->len - written));
+    rc = uv_fs_write(NULL, &req, fd, &chunk, 1, -1, NULL);
+    uv_fs_req_cleanup(&req);
+    if (rc > 0) {
+      written += (size_t)rc;
+    } else if (rc == 0) {
+      rc = UV_EIO;
+    }
+  }
+  if (rc >= 0) {
+    rc = uv_fs_fsync(NULL, &req, fd, NULL);
+    uv_fs_req_cleanup(&req);
+  }
+
+  int close_rc = uv_fs_close(NULL, &req, fd, NULL);
+  uv_fs_req_cleanup(&req);
+
+  if (rc < 0) {
+    return rc;
+  }
+  return (close_rc < 0) ? close_rc : 0;
+}
+
+// One save: a snapshot of the table, and where it goes
+typedef struct CacheSave {
+  uv_work_t work;
+  CacheBuffer buf;
+  char* path;
+  char* tmp_path;
+  // Set by the threadpool: 0 or a libuv error code, and which file it concerns
+  int rc;
+  const char* failed_path;
+} CacheSave;
+
+// Runs on the threadpool
+static void save_work(uv_work_t* work) {
+  CacheSave* save = work->data;
+  uv_fs_t req;
+
+  int rc = write_cache_file(save->tmp_path, &save->buf);
+  if (rc == 0) {
+    // uv_fs_rename replaces an existing file on Windows too, unlike rename()
+    rc = uv_fs_rename(NULL, &req, save->tmp_path, save->path, NULL);
+    uv_fs_req_cleanup(&req);
+    save->failed_path = save->path;
+  } else {
+    save->failed_path = save->tmp_path;
+  }
+  save->rc = rc;
+  if (rc != 0) {
+    uv_fs_unlink(NULL, &req, save->tmp_path, NULL);
+    uv_fs_req_cleanup(&req);
+  }
+}
+
+static void start_save(void);
+
+static void after_save_work(uv_work_t* work, int status) {
+  (void) status;
+  CacheSave* save = work->data;
+  // Logged here, since the logger belongs to the loop thread
+  if (save->rc != 0) {
+    ZITI_NODEJS_LOG(WARN, "cannot write service cache %s: %s", save->failed_path, uv_strerror(save->rc));
+  }
+  free(save->buf.data);
+  free(save->path);
+  free(save->tmp_path);
+  free(save);
+
+  save_in_flight = false;
+  if (save_pending) {
+    save_pending = false;
+    start_save();
+  }
+}
+
+// Snapshot the table and hand the write to the threadpool
+static void start_save(void) {
+  if (cache_path == NULL) {
+    return;
+  }
+
+  CacheSave* save = calloc(1, sizeof(*save));
+  save->work.data = save;
+  save->path = strdup(cache_path);
+  size_t path_len = strlen(cache_path);
+  save->tmp_path = malloc(path_len + sizeof(".tmp"));
+  memcpy(save->tmp_path, cache_path, path_len);
+  memcpy(save->tmp_path + path_len, ".tmp", sizeof(".tmp"));
+
+  append(&save->buf, SERVICE_CACHE_HEADER, strlen(SERVICE_CACHE_HEADER));
+  for_each_service(write_record, &save->buf);
+
+  int rc = uv_queue_work(get_ziti_loop(), &save->work, save_work, after_save_work);
+  if (rc != 0) {
+    ZITI_NODEJS_LOG(WARN, "cannot save service cache %s: %s", save->path, uv_strerror(rc));
+    free(save->buf.data);
+    free(save->path);
+    free(save->tmp_path);
+    free(save);
+    return;
+  }
+  save_in_flight = true;
+}
+
+/**
+ * Write the service table to the service cache, if there is one. Called after every service event,
+ * on the loop thread; returns before the file is written.
+ */
+void save_service_cache(void) {
+  if (cache_path == NULL) {
+    return;
+  }
+  if (save_in_flight) {
+    save_pending = true;
+    return;
+  }
+  start_save();
+}
@@ -0,0 +1,284 @@
+/*
+Copyright NetFoundry Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ziti-nodejs.h"
+#include <string.h>
+
+
+// Set by ziti_set_service_event_callback on the JS thread, read by publish_service_event on the thread that
+// runs the SDK; NULL while nobody is listening. Guarded by service_event_lock.
+static Dispatcher *service_event_dispatcher = NULL;
+static uv_mutex_t service_event_lock;
+static uv_once_t service_event_lock_once = UV_ONCE_INIT;
+
+
+static void init_service_event_lock(void) {
+  uv_mutex_init(&service_event_lock);
+}
+
+// One service event's diff, as handed to the JavaScript callback: added, then changed, then removed
+typedef struct ServiceEventItem {
+  size_t added_count;
+  size_t changed_count;
+  size_t removed_count;
+  ServiceInfo *services;
+} ServiceEventItem;
+
+
+static char *strdup_or_null(const char *s) {
+  return (s != NULL) ? strdup(s) : NULL;
+}
+
+/**
+ * Copy what JS (and the service table) needs to know about a service, so it outlives the event
+ */
+void copy_service_info(ServiceInfo *info, const ziti_service *s) {
+  info->name = strdup_or_null(s->name);
+  info->id = strdup_or_null(s->id);
+  info->perm_flags = s->perm_flags;
+  info->intercept_cfg = strdup_or_null(ziti_service_get_raw_config(s, ZITI_INTERCEPT_CFG_V1));
+  info->client_cfg = strdup_or_null(ziti_service_get_raw_config(s, ZITI_CLIENT_CFG_V1));
+  info->zrok_cfg = strdup_or_null(ziti_service_get_raw_config(s, ZROK_PROXY_CFG_V1));
+}
+
+void free_service_info(ServiceInfo *info) {
+  free(info->name);
+  free(info->id);
+  free(info->intercept_cfg);
+  free(info->client_cfg);
+  free(info->zrok_cfg);
+}
+
+static void free_service_event_item(ServiceEventItem *item) {
+  size_t count = item->added_count + item->changed_count + item->removed_count;
+  for (size_t i = 0; i < count; i++) {
+    free_service_info(&item->services[i]);
+  }
+  free(item->services);
+  free(item);
+}
+
+
+static void set_string_property(napi_env env, napi_value obj, const char *name, const char *value) {
+  napi_value js_value;
+  if (value == NULL) {
+    return;
+  }
+  NAPI_CHECK(env, "create string", napi_create_string_utf8(env, value, NAPI_AUTO_LENGTH, &js_value));
+  NAPI_CHECK(env, "set string property", napi_set_named_property(env, obj, name, js_value));
+}
+
+/**
+ * { name, id, permissions: { dial, bind }, configs: { <config type>: <raw JSON> } }
+ */
+static napi_value service_info_to_js(napi_env env, const ServiceInfo *info) {
+  napi_value js_service, js_perms, js_configs, js_bool;
+
+  napi_create_object(env, &js_service);
+  set_string_property(env, js_service, "name", info->name);
+  set_string_property(env, js_service, "id", info->id);
+
+  napi_create_object(env, &js_perms);
+  napi_get_boolean(env, (info->perm_flags & ZITI_CAN_DIAL) != 0, &js_bool);
+  napi_set_named_property(env, js_perms, "dial", js_bool);
+  napi_get_boolean(env, (info->perm_flags & ZITI_CAN_BIND) != 0, &js_bool);
+  napi_set_named_property(env, js_perms, "bind", js_bool);
+  napi_set_named_property(env, js_service, "permissions", js_perms);
+
+  napi_create_object(env, &js_configs);
+  set_string_property(env, js_configs, ZITI_INTERCEPT_CFG_V1, info->intercept_cfg);
+  set_string_property(env, js_configs, ZITI_CLIENT_CFG_V1, info->client_cfg);
+  set_string_property(env, js_configs, ZROK_PROXY_CFG_V1, info->zrok_cfg);
+  napi_set_named_property(env, js_service, "configs", js_configs);
+
+  return js_service;
+}
+
+static napi_value service_list_to_js(napi_env env, const ServiceInfo *services, size_t count) {
+  napi_value js_list;
+  napi_create_array_with_length(env, count, &js_list);
+  for (size_t i = 0; i < count; i++) {
+    napi_set_element(env, js_list, (uint32_t)i, service_info_to_js(env, &services[i]));
+  }
+  return js_list;
+}
+
+/**
+ * This function is responsible for calling the JavaScript callback function
+ * that was specified when ziti_set_service_event_callback(...) was called from JavaScript.
+ */
+static void CallJs_on_service_event(napi_env env, napi_value js_cb, void* context, void* data) {
+  (void) context;
+
+  ServiceEventItem *item = (ServiceEventItem *)data;
+
+  // env and js_cb may both be NULL if Node.js is in its cleanup phase
+  if (env != NULL && js_cb != NULL) {
+    NAPI_UNDEFINED(env, undefined);
+
+    // { added: [...], changed: [...], removed: [...] }
+    napi_value js_event;
+    NAPI_CHECK(env, "create service event", napi_create_object(env, &js_event));
+    napi_set_named_property(env, js_event, "added",
+                            service_list_to_js(env, item->services, item->added_count));
+    napi_set_named_property(env, js_event, "changed",
+                            service_list_to_js(env, item->services + item->added_count, item->changed_count));
+    napi_set_named_property(env, js_event, "removed",
+                            service_list_to_js(env, item->services + item->added_count + item->changed_count, item->removed_count));
+
+    NAPI_CHECK(env, "calling service event callback",
+               napi_call_function(env, undefined, js_cb, 1, &js_event, NULL));
+  }
+
+  free_service_event_item(item);
+}
+
+
+static size_t count_services(ziti_service **list) {
+  size_t count = 0;
+  for (; list != NULL && list[count] != NULL; count++);
+  return count;
+}
+
+// One event's diff, copied out for the listener; NULL when it changed nothing
+static ServiceEventItem *new_service_event_item(const ziti_event_t *event) {
+  ServiceEventItem *item = calloc(1, sizeof(*item));
+  item->added_count = count_services(event->service.added);
+  item->changed_count = count_services(event->service.changed);
+  item->removed_count = count_services(event->service.removed);
+
+  size_t count = item->added_count + item->changed_count + item->removed_count;
+  if (count == 0) {
+    free(item);
+    return NULL;
+  }
+
+  item->services = calloc(count, sizeof(ServiceInfo));
+  ServiceInfo *info = item->services;
+  for (size_t i = 0; i < item->added_count; i++) {
+    copy_service_info(info++, event->service.added[i]);
+  }
+  for (size_t i = 0; i < item->changed_count; i++) {
+    copy_service_info(info++, event->service.changed[i]);
+  }
+  for (size_t i = 0; i < item->removed_count; i++) {
+    copy_service_info(info++, event->service.removed[i]);
+  }
+  return item;
+}
+
+// Every service the identity already has, as one event that adds them all; NULL when there are none
+static ServiceEventItem *new_current_services_item(void) {
+  size_t count;
+  ServiceInfo *services = copy_confirmed_services(&count);
+  if (count == 0) {
+    free(services);
+    return NULL;
+  }
+
+  ServiceEventItem *item = calloc(1, sizeof(*item));
+  item->added_count = count;
+  item->services = services;
+  return item;
+}
+
+static void deliver_service_event(Dispatcher *dispatcher, ServiceEventItem *item) {
+  if (dispatch_to_js(dispatcher, item) != napi_ok) {
+    ZITI_NODEJS_LOG(ERROR, "Unable to dispatch_to_js");
+    free_service_event_item(item);
+  }
+}
+
+/**
+ * Apply a ZitiServiceEvent to the service table and hand it to the JS listener (if there is one) as a
+ * single diff. The diff is taken under service_event_lock along with the table update, so a listener
+ * subscribing meanwhile sees the event either in its initial table or as a diff, never both. It is
+ * delivered after unlocking, since the listener may subscribe or unsubscribe from its callback; the
+ * tsfn is acquired so the dispatcher outlives a listener that is replaced in the meantime.
+ */
+void publish_service_event(const ziti_event_t *event) {
+  uv_once(&service_event_lock_once, init_service_event_lock);
+  uv_mutex_lock(&service_event_lock);
+
+  update_service_table(event);
+  Dispatcher *dispatcher = service_event_dispatcher;
+  ServiceEventItem *item = NULL;
+  if ((dispatcher != NULL) && (napi_acquire_threadsafe_function(dispatcher->tsfn) == napi_ok)) {
+    item = new_service_event_item(event);
+    if (item == NULL) {
+      napi_release_threadsafe_function(dispatcher->tsfn, napi_tsfn_release);
+    }
+  }
+
+  uv_mutex_unlock(&service_event_lock);
+
+  if (item != NULL) {
+    deliver_service_event(dispatcher, item);
+    napi_release_threadsafe_function(dispatcher->tsfn, napi_tsfn_release);
+  }
+}
+
+
+/**
+ * Set (or, given undefined, clear) the function that receives each service event's diff
+ */
+static napi_value _ziti_set_service_event_callback(napi_env env, const napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  NAPI_CHECK(env, "parse args", napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+  if (argc < 1) {
+    napi_throw_error(env, "EINVAL", "Too few arguments");
+    return NULL;
+  }
+
+  napi_valuetype arg_type = napi_undefined;
+  NAPI_CHECK(env, "get arg type", napi_typeof(env, args[0], &arg_type));
+  if ((arg_type != napi_undefined) && (arg_type != napi_function)) {
+    napi_throw_error(env, "EINVAL", "Argument must be a function");
+    return NULL;
+  }
+
+  Dispatcher *dispatcher = NULL;
+  if (arg_type == napi_function) {
+    NAPI_CHECK(env, "create dispatcher",
+               create_dispatcher(env, args[0], "N-API on_service_event", CallJs_on_service_event, &dispatcher));
+    // Listening for service events must not keep the process alive
+    napi_unref_threadsafe_function(env, dispatcher->tsfn);
+  }
+
+  uv_once(&service_event_lock_once, init_service_event_lock);
+  uv_mutex_lock(&service_event_lock);
+  Dispatcher *previous = service_event_dispatcher;
+  service_event_dispatcher = dispatcher;
+  ServiceEventItem *current = (dispatcher != NULL) ? new_current_services_item() : NULL;
+  uv_mutex_unlock(&service_event_lock);
+
+  // A publish still delivering to it holds its own reference
+  if (previous != NULL) {
+    release_dispatcher(previous);
+  }
+
+  // The new listener gets the current services before this returns, so ahead of any later event
+  if (current != NULL) {
+    deliver_service_event(dispatcher, current);
+  }
+
+  NAPI_UNDEFINED(env, undefined);
+  return undefined;
+}
+
+ZNODE_EXPOSE(ziti_set_service_event_callback, _ziti_set_service_event_callback)
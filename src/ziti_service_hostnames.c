@@ -0,0 +1,261 @@
+/*
+Copyright NetFoundry Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ziti-nodejs.h"
+#include <string.h>
+
+
+// Index of the (hostname, port interval) entries each service is reachable at, as learned from its
+// intercept/client configs. Chained hash table keyed by service name; it doubles its buckets once
+// it holds as many services as it has buckets, so there is no limit on the number of services.
+#define SERVICE_HOSTNAMES_MIN_BUCKETS 64
+
+typedef struct ServiceHostnames {
+  struct ServiceHostnames* next;        // next service in the same bucket
+  char* service_name;
+  uint32_t hash;
+  size_t count;
+  size_t capacity;
+  ServiceHostnameEntry* entries;        // in the order they were tracked
+} ServiceHostnames;
+
+static ServiceHostnames** buckets = NULL;
+static size_t bucket_count = 0;
+static size_t service_count = 0;
+
+
+// FNV-1a
+static uint32_t hash_name(const char* name) {
+  uint32_t hash = 2166136261u;
+  for (const unsigned char* p = (const unsigned char*)name; *p != '\0'; p++) {
+    hash ^= *p;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static void grow_buckets(void) {
+  size_t new_count = (bucket_count == 0) ? SERVICE_HOSTNAMES_MIN_BUCKETS : (bucket_count * 2);
+  ServiceHostnames** new_buckets = calloc(new_count, sizeof(*new_buckets));
+
+  for (size_t i = 0; i < bucket_count; i++) {
+    ServiceHostnames* sh = buckets[i];
+    while (sh != NULL) {
+      ServiceHostnames* next = sh->next;
+      size_t slot = sh->hash & (new_count - 1);
+      sh->next = new_buckets[slot];
+      new_buckets[slot] = sh;
+      sh = next;
+    }
+  }
+
+  free(buckets);
+  buckets = new_buckets;
+  bucket_count = new_count;
+}
+
+static ServiceHostnames* find_service(const char* service_name, uint32_t hash) {
+  if (bucket_count == 0) {
+    return NULL;
+  }
+  for (ServiceHostnames* sh = buckets[hash & (bucket_count - 1)]; sh != NULL; sh = sh->next) {
+    if ((sh->hash == hash) && (strcmp(sh->service_name, service_name) == 0)) {
+      return sh;
+    }
+  }
+  return NULL;
+}
+
+static void free_entries(ServiceHostnames* sh) {
+  for (size_t i = 0; i < sh->count; i++) {
+    free(sh->entries[i].hostname);
+  }
+  sh->count = 0;
+}
+
+
+/**
+ * Record that 'service_name' is reachable at 'hostname' on ports low_port..high_port.
+ * A whole intercept range is one entry; an interval already recorded for the hostname is widened
+ * to take in one that overlaps or adjoins it.
+ */
+void track_service_to_hostname(const char* service_name, const char* hostname, int low_port, int high_port) {
+
+  ZITI_NODEJS_LOG(TRACE, "service_name: %s hostname: %s ports: %d-%d", service_name, hostname, low_port, high_port);
+
+  if ((NULL == service_name) || (NULL == hostname) || (low_port > high_port)) {
+    return;
+  }
+
+  uint32_t hash = hash_name(service_name);
+  ServiceHostnames* sh = find_service(service_name, hash);
+
+  if (NULL == sh) {
+    if (service_count + 1 > bucket_count) {
+      grow_buckets();
+    }
+    sh = calloc(1, sizeof(*sh));
+    sh->service_name = strdup(service_name);
+    sh->hash = hash;
+    size_t slot = hash & (bucket_count - 1);
+    sh->next = buckets[slot];
+    buckets[slot] = sh;
+    service_count++;
+  }
+
+  for (size_t i = 0; i < sh->count; i++) {
+    ServiceHostnameEntry* e = &sh->entries[i];
+    if ((strcmp(e->hostname, hostname) == 0) && (low_port <= e->high_port + 1) && (high_port + 1 >= e->low_port)) {
+      e->low_port = (low_port < e->low_port) ? low_port : e->low_port;
+      e->high_port = (high_port > e->high_port) ? high_port : e->high_port;
+      // Keep the most recently tracked interval last, since that is the one lookups use
+      ServiceHostnameEntry widened = *e;
+      memmove(e, e + 1, (sh->count - i - 1) * sizeof(*e));
+      sh->entries[sh->count - 1] = widened;
+      return;
+    }
+  }
+
+  if (sh->count == sh->capacity) {
+    sh->capacity = (sh->capacity == 0) ? 4 : (sh->capacity * 2);
+    sh->entries = realloc(sh->entries, sh->capacity * sizeof(*sh->entries));
+  }
+  ServiceHostnameEntry* e = &sh->entries[sh->count++];
+  e->hostname = strdup(hostname);
+  e->low_port = low_port;
+  e->high_port = high_port;
+}
+
+
+/**
+ * Record where a service is reachable according to its configs, replacing what was recorded for it.
+ * The first config that parses wins: intercept.v1, then ziti-tunneler-client.v1, then zrok.proxy.v1
+ * (which makes the service reachable by its own name on port 80).
+ */
+void track_service_hostnames(const ServiceInfo* info) {
+  clear_service_hostnames(info->name);
+
+  if (info->intercept_cfg != NULL) {
+    ziti_intercept_cfg_v1 *intercept = alloc_ziti_intercept_cfg_v1();
+    bool parsed = (parse_ziti_intercept_cfg_v1(intercept, info->intercept_cfg, strlen(info->intercept_cfg)) >= 0);
+    if (parsed) {
+      const ziti_address *range_addr;
+      MODEL_LIST_FOREACH(range_addr, intercept->addresses) {
+        ziti_port_range *p;
+        MODEL_LIST_FOREACH(p, intercept->port_ranges) {
+          track_service_to_hostname(info->name, range_addr->addr.hostname, p->low, p->high);
+        }
+      }
+    }
+    free_ziti_intercept_cfg_v1(intercept);
+    free(intercept);
+    if (parsed) {
+      return;
+    }
+  }
+
+  if (info->client_cfg != NULL) {
+    ziti_client_cfg_v1 clt_cfg = {
+            .hostname = {0},
+            .port = 0
+    };
+    bool parsed = (parse_ziti_client_cfg_v1(&clt_cfg, info->client_cfg, strlen(info->client_cfg)) >= 0);
+    if (parsed) {
+      track_service_to_hostname(info->name, clt_cfg.hostname.addr.hostname, clt_cfg.port, clt_cfg.port);
+    }
+    free_ziti_client_cfg_v1(&clt_cfg);
+    if (parsed) {
+      return;
+    }
+  }
+
+  if (info->zrok_cfg != NULL) {
+    track_service_to_hostname(info->name, info->name, 80, 80);
+  }
+}
+
+
+/**
+ * Forget every entry recorded for 'service_name' (before its configs are re-read, or once it is removed)
+ */
+void clear_service_hostnames(const char* service_name) {
+  uint32_t hash = hash_name(service_name);
+  if (bucket_count == 0) {
+    return;
+  }
+
+  ServiceHostnames** link = &buckets[hash & (bucket_count - 1)];
+  while (*link != NULL) {
+    ServiceHostnames* sh = *link;
+    if ((sh->hash == hash) && (strcmp(sh->service_name, service_name) == 0)) {
+      *link = sh->next;
+      free_entries(sh);
+      free(sh->entries);
+      free(sh->service_name);
+      free(sh);
+      service_count--;
+      return;
+    }
+    link = &sh->next;
+  }
+}
+
+
+/**
+ * The hostname and port to reach 'service_name' at: the most recently tracked interval, at its high
+ * port (just as when every port of a range was tracked one at a time). NULL if the service has none.
+ */
+const ServiceHostnameEntry* get_service_hostname(const char* service_name, int* port) {
+  ServiceHostnames* sh = find_service(service_name, hash_name(service_name));
+  if ((NULL == sh) || (0 == sh->count)) {
+    ZITI_NODEJS_LOG(TRACE, "no hostname for service: %s", service_name);
+    return NULL;
+  }
+
+  const ServiceHostnameEntry* e = &sh->entries[sh->count - 1];
+  *port = e->high_port;
+  ZITI_NODEJS_LOG(TRACE, "service: %s -> hostname: %s port: %d", service_name, e->hostname, *port);
+  return e;
+}
+
+
+// 'pattern' is either a hostname or a "*.domain" wildcard, matched case-insensitively
+static bool hostname_matches(const char* pattern, const char* hostname) {
+  if ((pattern[0] == '*') && (pattern[1] == '.')) {
+    size_t suffix_len = strlen(pattern + 1);
+    size_t len = strlen(hostname);
+    return (len > suffix_len) && (strncasecmp(hostname + len - suffix_len, pattern + 1, suffix_len) == 0);
+  }
+  return strcasecmp(pattern, hostname) == 0;
+}
+
+/**
+ * The service reachable at 'hostname' on 'port', by a scan of every tracked entry; NULL if none.
+ * Only for resolving addresses from the service cache before the SDK knows the services.
+ */
+const char* find_service_for_hostname(const char* hostname, int port) {
+  for (size_t i = 0; i < bucket_count; i++) {
+    for (ServiceHostnames* sh = buckets[i]; sh != NULL; sh = sh->next) {
+      for (size_t j = 0; j < sh->count; j++) {
+        const ServiceHostnameEntry* e = &sh->entries[j];
+        if ((port >= e->low_port) && (port <= e->high_port) && hostname_matches(e->hostname, hostname)) {
+          return sh->service_name;
+        }
+      }
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,382 @@
+/*
+Copyright NetFoundry Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ziti-nodejs.h"
+#include <string.h>
+
+
+// The services the identity currently has, as of the last ZitiServiceEvent, keyed by name.
+// Chained hash table that doubles its buckets once it holds as many services as it has buckets.
+// Written from the thread that runs the SDK, read synchronously from JS, hence the lock.
+#define SERVICE_TABLE_MIN_BUCKETS 64
+
+// Names up to this long are looked up without allocating
+#define SERVICE_NAME_STACK_LEN 256
+
+typedef struct ServiceTableEntry {
+  struct ServiceTableEntry* next;       // next service in the same bucket
+  uint32_t hash;
+  bool provisional;                     // restored from the service cache, not yet confirmed by the controller
+  ServiceInfo info;
+} ServiceTableEntry;
+
+static ServiceTableEntry** buckets = NULL;
+static size_t bucket_count = 0;
+static size_t service_count = 0;
+static size_t provisional_count = 0;
+static uv_rwlock_t table_lock;
+static uv_once_t table_lock_once = UV_ONCE_INIT;
+
+
+static void init_table_lock(void) {
+  uv_rwlock_init(&table_lock);
+}
+
+// FNV-1a
+static uint32_t hash_name(const char* name, size_t len) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= (unsigned char)name[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static void grow_buckets(void) {
+  size_t new_count = (bucket_count == 0) ? SERVICE_TABLE_MIN_BUCKETS : (bucket_count * 2);
+  ServiceTableEntry** new_buckets = calloc(new_count, sizeof(*new_buckets));
+
+  for (size_t i = 0; i < bucket_count; i++) {
+    ServiceTableEntry* e = buckets[i];
+    while (e != NULL) {
+      ServiceTableEntry* next = e->next;
+      size_t slot = e->hash & (new_count - 1);
+      e->next = new_buckets[slot];
+      new_buckets[slot] = e;
+      e = next;
+    }
+  }
+
+  free(buckets);
+  buckets = new_buckets;
+  bucket_count = new_count;
+}
+
+static ServiceTableEntry** find_link(const char* name, size_t len, uint32_t hash) {
+  if (bucket_count == 0) {
+    return NULL;
+  }
+  ServiceTableEntry** link = &buckets[hash & (bucket_count - 1)];
+  for (; *link != NULL; link = &(*link)->next) {
+    ServiceTableEntry* e = *link;
+    if ((e->hash == hash) && (strncmp(e->info.name, name, len) == 0) && (e->info.name[len] == '\0')) {
+      return link;
+    }
+  }
+  return NULL;
+}
+
+// Call with the write lock held
+static void put_service(const ziti_service* s) {
+  size_t len = strlen(s->name);
+  uint32_t hash = hash_name(s->name, len);
+  ServiceTableEntry** link = find_link(s->name, len, hash);
+
+  if (link != NULL) {
+    if ((*link)->provisional) {
+      (*link)->provisional = false;
+      provisional_count--;
+    }
+    free_service_info(&(*link)->info);
+    copy_service_info(&(*link)->info, s);
+    return;
+  }
+
+  if (service_count + 1 > bucket_count) {
+    grow_buckets();
+  }
+  ServiceTableEntry* e = calloc(1, sizeof(*e));
+  e->hash = hash;
+  copy_service_info(&e->info, s);
+  size_t slot = hash & (bucket_count - 1);
+  e->next = buckets[slot];
+  buckets[slot] = e;
+  service_count++;
+}
+
+// Call with the write lock held
+static void remove_service(const char* name) {
+  size_t len = strlen(name);
+  ServiceTableEntry** link = find_link(name, len, hash_name(name, len));
+  if (link == NULL) {
+    return;
+  }
+  ServiceTableEntry* e = *link;
+  *link = e->next;
+  if (e->provisional) {
+    provisional_count--;
+  }
+  free_service_info(&e->info);
+  free(e);
+  service_count--;
+}
+
+// Call with the write lock held. Drop the cached services the controller did not confirm.
+static void drop_provisional_services(void) {
+  for (size_t i = 0; (i < bucket_count) && (provisional_count > 0); i++) {
+    ServiceTableEntry** link = &buckets[i];
+    while (*link != NULL) {
+      ServiceTableEntry* e = *link;
+      if (!e->provisional) {
+        link = &e->next;
+        continue;
+      }
+      ZITI_NODEJS_LOG(INFO, "cached service [%s] is gone", e->info.name);
+      clear_service_hostnames(e->info.name);
+      invalidate_service_cache(e->info.name, false);
+      *link = e->next;
+      free_service_info(&e->info);
+      free(e);
+      service_count--;
+      provisional_count--;
+    }
+  }
+}
+
+
+/**
+ * Add a service restored from the service cache (taking ownership of 'info'). It stays provisional
+ * until a service event from the controller confirms it.
+ */
+void restore_service(ServiceInfo* info) {
+  uv_once(&table_lock_once, init_table_lock);
+  uv_rwlock_wrlock(&table_lock);
+
+  size_t len = strlen(info->name);
+  uint32_t hash = hash_name(info->name, len);
+  if (find_link(info->name, len, hash) != NULL) {
+    free_service_info(info);
+  } else {
+    if (service_count + 1 > bucket_count) {
+      grow_buckets();
+    }
+    ServiceTableEntry* e = calloc(1, sizeof(*e));
+    e->hash = hash;
+    e->provisional = true;
+    e->info = *info;
+    size_t slot = hash & (bucket_count - 1);
+    e->next = buckets[slot];
+    buckets[slot] = e;
+    service_count++;
+    provisional_count++;
+  }
+
+  uv_rwlock_wrunlock(&table_lock);
+}
+
+/**
+ * Whether the table still holds services restored from the cache that the controller has not confirmed
+ */
+bool services_provisional(void) {
+  uv_once(&table_lock_once, init_table_lock);
+  uv_rwlock_rdlock(&table_lock);
+  bool provisional = (provisional_count > 0);
+  uv_rwlock_rdunlock(&table_lock);
+  return provisional;
+}
+
+
+/**
+ * Apply a ZitiServiceEvent to the table. The first one after a restore from the service cache
+ * reconciles it: cached services the event did not confirm are dropped.
+ */
+void update_service_table(const ziti_event_t* event) {
+  uv_once(&table_lock_once, init_table_lock);
+  uv_rwlock_wrlock(&table_lock);
+
+  for (ziti_service** sp = event->service.removed; sp != NULL && *sp != NULL; sp++) {
+    remove_service((*sp)->name);
+  }
+  for (ziti_service** sp = event->service.added; sp != NULL && *sp != NULL; sp++) {
+    put_service(*sp);
+  }
+  for (ziti_service** sp = event->service.changed; sp != NULL && *sp != NULL; sp++) {
+    put_service(*sp);
+  }
+  drop_provisional_services();
+
+  uv_rwlock_wrunlock(&table_lock);
+}
+
+/**
+ * Visit every service in the table (under the read lock; 'fn' must not call back into the table)
+ */
+void for_each_service(void (*fn)(const ServiceInfo* info, void* ctx), void* ctx) {
+  uv_once(&table_lock_once, init_table_lock);
+  uv_rwlock_rdlock(&table_lock);
+  for (size_t i = 0; i < bucket_count; i++) {
+    for (ServiceTableEntry* e = buckets[i]; e != NULL; e = e->next) {
+      fn(&e->info, ctx);
+    }
+  }
+  uv_rwlock_rdunlock(&table_lock);
+}
+
+/**
+ * Copy out the services the controller has confirmed (not those still provisional from the service cache).
+ * The caller owns the returned array and each ServiceInfo in it.
+ */
+ServiceInfo* copy_confirmed_services(size_t* count) {
+  uv_once(&table_lock_once, init_table_lock);
+  uv_rwlock_rdlock(&table_lock);
+
+  size_t n = 0;
+  ServiceInfo* services = NULL;
+  if (service_count > provisional_count) {
+    services = calloc(service_count - provisional_count, sizeof(ServiceInfo));
+    for (size_t i = 0; i < bucket_count; i++) {
+      for (ServiceTableEntry* e = buckets[i]; e != NULL; e = e->next) {
+        if (e->provisional) {
+          continue;
+        }
+        ServiceInfo* info = &services[n++];
+        info->name = strdup(e->info.name);
+        info->id = (e->info.id != NULL) ? strdup(e->info.id) : NULL;
+        info->perm_flags = e->info.perm_flags;
+        info->intercept_cfg = (e->info.intercept_cfg != NULL) ? strdup(e->info.intercept_cfg) : NULL;
+        info->client_cfg = (e->info.client_cfg != NULL) ? strdup(e->info.client_cfg) : NULL;
+        info->zrok_cfg = (e->info.zrok_cfg != NULL) ? strdup(e->info.zrok_cfg) : NULL;
+      }
+    }
+  }
+
+  uv_rwlock_rdunlock(&table_lock);
+
+  *count = n;
+  return services;
+}
+
+/**
+ * The permissions (ZITI_CAN_DIAL | ZITI_CAN_BIND) the identity has on the service, or
+ * ZITI_SERVICE_UNAVAILABLE if it has no such service
+ */
+static int32_t lookup_permissions(const char* name, size_t len) {
+  int32_t result = ZITI_SERVICE_UNAVAILABLE;
+
+  uv_once(&table_lock_once, init_table_lock);
+  uv_rwlock_rdlock(&table_lock);
+  ServiceTableEntry** link = find_link(name, len, hash_name(name, len));
+  if (link != NULL) {
+    result = (*link)->info.perm_flags;
+  }
+  uv_rwlock_rdunlock(&table_lock);
+
+  return result;
+}
+
+static bool lookup_js_name(napi_env env, napi_value js_name, int32_t* result) {
+  char stack_name[SERVICE_NAME_STACK_LEN];
+  size_t len;
+
+  if (napi_get_value_string_utf8(env, js_name, NULL, 0, &len) != napi_ok) {
+    return false;
+  }
+
+  char* name = (len < sizeof(stack_name)) ? stack_name : malloc(len + 1);
+  napi_get_value_string_utf8(env, js_name, name, len + 1, &len);
+  *result = lookup_permissions(name, len);
+  if (name != stack_name) {
+    free(name);
+  }
+  return true;
+}
+
+
+/**
+ * @param {string} [0] service name
+ *
+ * @returns {number} the permissions bitmask, or a negative status if the identity has no such service
+ */
+static napi_value _ziti_service_available_sync(napi_env env, const napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  NAPI_CHECK(env, "parse args", napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+  if (argc < 1) {
+    napi_throw_error(env, "EINVAL", "Too few arguments");
+    return NULL;
+  }
+
+  int32_t permissions;
+  if (!lookup_js_name(env, args[0], &permissions)) {
+    napi_throw_error(env, "EINVAL", "Service Name not provided");
+    return NULL;
+  }
+
+  napi_value js_result;
+  NAPI_CHECK(env, "create result", napi_create_int32(env, permissions, &js_result));
+  return js_result;
+}
+
+/**
+ * @param {string[]} [0] service names
+ *
+ * @returns {Int32Array} for each name, what ziti_service_available_sync would return
+ */
+static napi_value _ziti_services_available_sync(napi_env env, const napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  NAPI_CHECK(env, "parse args", napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+  if (argc < 1) {
+    napi_throw_error(env, "EINVAL", "Too few arguments");
+    return NULL;
+  }
+
+  uint32_t count;
+  if (napi_get_array_length(env, args[0], &count) != napi_ok) {
+    napi_throw_error(env, "EINVAL", "Argument must be an array of service names");
+    return NULL;
+  }
+
+  napi_value js_buffer, js_result;
+  int32_t* results;
+  NAPI_CHECK(env, "create result buffer",
+             napi_create_arraybuffer(env, count * sizeof(int32_t), (void**)&results, &js_buffer));
+  NAPI_CHECK(env, "create result array",
+             napi_create_typedarray(env, napi_int32_array, count, js_buffer, 0, &js_result));
+
+  for (uint32_t i = 0; i < count; i++) {
+    napi_value js_name;
+    if ((napi_get_element(env, args[0], i, &js_name) != napi_ok) || !lookup_js_name(env, js_name, &results[i])) {
+      napi_throw_error(env, "EINVAL", "Service names must be strings");
+      return NULL;
+    }
+  }
+
+  return js_result;
+}
+
+static napi_value _ziti_services_provisional(napi_env env, const napi_callback_info info) {
+  (void) info;
+  napi_value js_result;
+  NAPI_CHECK(env, "create result", napi_get_boolean(env, services_provisional(), &js_result));
+  return js_result;
+}
+
+ZNODE_EXPOSE(ziti_service_available_sync, _ziti_service_available_sync)
+ZNODE_EXPOSE(ziti_services_provisional, _ziti_services_provisional)
+ZNODE_EXPOSE(ziti_services_available_sync, _ziti_services_available_sync)
@@ -20,6 +20,13 @@ limitations under the License.
 void ziti_services_refresh(ziti_context ztx, bool now);
 
 
+static void services_refresh_command(void *arg) {
+  (void) arg;
+
+  ziti_services_refresh(ztx, true);
+}
+
+
 /**
  * 
  */
@@ -30,7 +37,7 @@ napi_value _ziti_services_refresh(napi_env env, const napi_callback_info info) {
   ZITI_NODEJS_LOG(INFO, "ziti_services_refresh initiated");
 
   // Now, call the C-SDK to refresh the services list
-  ziti_services_refresh(ztx, true);
+  run_on_ziti_thread(services_refresh_command, NULL);
 
   status = napi_create_int32(env, 0 /* always succeed here */, &jsRetval);
   if (status != napi_ok) {
@@ -110,7 +110,6 @@ static void CallJs_on_data(napi_env env, napi_value js_cb, void* context, void*
   // items.
   if (env != NULL) {
     napi_value undefined, js_buffer;
-    void* result_data;
 
     // const obj = {}
     napi_value js_write_item, js_len;
@@ -132,13 +131,11 @@ static void CallJs_on_data(napi_env env, napi_value js_cb, void* context, void*
 
     // obj.data = buf
     if (item->buf) {
-      status = napi_create_buffer_copy(env,
-                                item->len,
-                                (const void*)item->buf,
-                                (void**)&result_data,
-                                &js_buffer);
+      // The Buffer takes ownership of item->buf, so it is not copied a second time
+      status = create_external_buffer(env, item->buf, item->len, &js_buffer);
+      item->buf = NULL;
       if (status != napi_ok) {
-        napi_throw_error(env, NULL, "Unable to napi_create_buffer_copy");
+        napi_throw_error(env, NULL, "Unable to create_external_buffer");
       }
       status = napi_set_named_property(env, js_write_item, "data", js_buffer);
       if (status != napi_ok) {
@@ -219,8 +216,11 @@ static void on_ws_read(uv_stream_t *stream, ssize_t status, const uv_buf_t *buf)
 
     ZITI_NODEJS_LOG(DEBUG, "<-------- %.*s", (int)status, buf->base);
 
-    item->buf = calloc(1, status);
-    memcpy(item->buf, buf->base, status);
+    // This is the only copy made on the inbound path; tlsuv reclaims buf->base once we return
+    if (status > 0) {
+      item->buf = malloc(status);
+      memcpy(item->buf, buf->base, status);
+    }
     item->len = status;
   
   }
@@ -234,6 +234,8 @@ static void on_ws_read(uv_stream_t *stream, ssize_t status, const uv_buf_t *buf)
       napi_tsfn_blocking);
   if (status != napi_ok) {
     ZITI_NODEJS_LOG(ERROR, "Unable to napi_call_threadsafe_function");
+    free(item->buf);
+    free(item);
   }
 }
 
@@ -253,6 +255,11 @@ napi_value _ziti_websocket_connect(napi_env env, const napi_callback_info info)
   size_t result;
   size_t argc = 4;
   napi_value args[4];
+
+  if (reject_on_net_thread(env, "websocketConnect")) {
+    return NULL;
+  }
+
   status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   if (status != napi_ok) {
     napi_throw_error(env, NULL, "Failed to parse arguments");
@@ -365,54 +372,8 @@ napi_value _ziti_websocket_connect(napi_env env, const napi_callback_info info)
   //
   // Capture headers
   //
-  uint32_t i;
-  status = napi_get_array_length(env, args[1], &addon_data->headers_array_length);
-  if (status != napi_ok) {
-    napi_throw_error(env, "EINVAL", "Failed to obtain headers array");
-  }
-  ZITI_NODEJS_LOG(DEBUG, "headers_array_length: %d", addon_data->headers_array_length);
-  for (i = 0; i < addon_data->headers_array_length; i++) {
-
-    napi_value headers_array_element;
-    status = napi_get_element(env, args[1], i, &headers_array_element);
-    if (status != napi_ok) {
-      napi_throw_error(env, "EINVAL", "Failed to obtain headers element");
-    }
-
-    // Obtain element length
-    size_t element_len;
-    status = napi_get_value_string_utf8(env, headers_array_element, NULL, 0, &element_len);
-    if (status != napi_ok) {
-      napi_throw_error(env, "EINVAL", "header arry element is not a string");
-    }
-    ZITI_NODEJS_LOG(DEBUG, "element_len: %zd", element_len);
-
-    if (element_len > 8*1024) {
-      ZITI_NODEJS_LOG(ERROR, "skipping header element; length too long");
-      break;
-    }
-
-    // Obtain element
-    char* header_element = calloc(1, element_len+2);
-    status = napi_get_value_string_utf8(env, headers_array_element, header_element, element_len+1, &result);
-    if (status != napi_ok) {
-      napi_throw_error(env, "EINVAL", "Failed to obtain element");
-    }
-    ZITI_NODEJS_LOG(DEBUG, "header_element: %s", header_element);
-
-    char * header_name = strtok(header_element, ":");
-    if (NULL == header_name) {
-      napi_throw_error(env, "EINVAL", "Failed to split header element");
-    }
-    char * header_value = strtok(NULL, ":");
-    if (strlen(header_value) < 1) {
-      napi_throw_error(env, "EINVAL", "Failed to split header element");
-    }
-
-    addon_data->header_name[i] = strdup(header_name);
-    addon_data->header_value[i] = strdup(header_value);
-
-    free(header_element);
+  if (capture_request_headers(env, args[1], &addon_data->headers) < 0) {
+    return NULL;
   }
 
   // Crank up the websocket
@@ -420,11 +381,8 @@ napi_value _ziti_websocket_connect(napi_env env, const napi_callback_info info)
   tlsuv_websocket_init_with_src(thread_loop, &(addon_data->ws), &(addon_data->ziti_src));
 
   // Add Cookies to request
-  for (int i = 0; i < (int)addon_data->headers_array_length; i++) {
-    tlsuv_http_req_header(addon_data->ws.req, addon_data->header_name[i], addon_data->header_value[i]);
-    free(addon_data->header_name[i]);
-    free(addon_data->header_value[i]);
-  }
+  apply_request_headers(addon_data->ws.req, &addon_data->headers);
+  free_request_headers(&addon_data->headers);
 
   addon_data->ws.data = addon_data;  // Pass our addon data around so we can eventually find our way back to the JS callback
   rc = tlsuv_websocket_connect(&(addon_data->req), &(addon_data->ws), url, on_connect, on_ws_read);
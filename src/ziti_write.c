@@ -16,26 +16,63 @@ limitations under the License.
 
 #include "ziti-nodejs.h"
 #include <string.h>
+#include <inttypes.h>
 
 
+// Segments shorter than this are gathered (copied) into a block by ziti_writev; longer ones are
+// pinned and sent in place, unless they fit in the block still being gathered
+#define ZITI_NODEJS_WRITEV_GATHER_THRESHOLD 4096
+
+// A gathered block takes in the segments after its small ones while it stays within this many bytes,
+// so a small header and a moderate body go out as one Ziti message
+#define ZITI_NODEJS_WRITEV_GATHER_MAX (64 * 1024)
+
+// While coalescing (but not corked), held-back writes are flushed early once this many bytes are waiting
+#define ZITI_NODEJS_COALESCE_FLUSH_BYTES (64 * 1024)
+
 // An item that will be generated here and passed into the JavaScript write callback
 typedef struct WriteItem {
   ziti_connection conn;
-  ssize_t status;
+  ConnAddonData* addon_data;
+  ssize_t status;         // total bytes written, or the first error
+  napi_ref cb_ref;        // the JS 'write' callback for this particular write
+  napi_ref buf_ref;       // reference pinning the caller's Buffer until on_write fires (zero-copy path)
+  napi_ref* seg_refs;     // ziti_writev: references pinning the segments sent in place (NULL for gathered ones)
+  uint32_t seg_count;
+  void* chunk;            // private copy of the caller's Buffer (copy path), or ziti_writev's gathered segments
+  uv_buf_t* bufs;         // what the C-SDK is asked to send, one ziti_write per entry
+  unsigned int nbufs;
+  uv_buf_t buf;           // storage for bufs when there is only one
+  unsigned int pending;   // parts whose on_write has not fired yet (plus one while they are being submitted)
+  struct WriteItem* next; // next write held back by cork/coalescing
 } WriteItem;
 
+// Several held-back writes sent as one ziti_write
+typedef struct CorkBatch {
+  ConnAddonData* addon_data;
+  WriteItem* items;       // oldest first
+  void* block;            // the items' data, gathered
+} CorkBatch;
+
+// Completes writes whose connection closed before the network thread got to them
+static Dispatcher* closed_write_dispatcher = NULL;
+
 
 /**
  * This function is responsible for calling the JavaScript 'write' callback function 
  * that was specified when the ziti_write(...) was called from JavaScript.
+ *
+ * The dispatcher this is attached to is shared by every write on the connection, so
+ * it carries no JS function of its own; the callback is taken from the WriteItem.
  */
 static void CallJs_on_write(napi_env env, napi_value js_cb, void* context, void* data) {
   napi_status status;
 
   ZITI_NODEJS_LOG(DEBUG, "CallJs_on_write entered");
 
-  // This parameter is not used.
+  // These parameters are not used.
   (void) context;
+  (void) js_cb;
 
   // Retrieve the WriteItem created by the worker thread.
   WriteItem* item = (WriteItem*)data;
@@ -85,44 +122,95 @@ static void CallJs_on_write(napi_env env, napi_value js_cb, void* context, void*
     }
 
     // Call the JavaScript function and pass it the WriteItem
+    napi_value js_write_cb;
+    status = napi_get_reference_value(env, item->cb_ref, &js_write_cb);
+    if (status != napi_ok) {
+      napi_throw_error(env, NULL, "Unable to napi_get_reference_value");
+    }
     status = napi_call_function(
         env,
         undefined,
-        js_cb,
+        js_write_cb,
         1,
         &js_write_item,
         NULL);
     if (status != napi_ok) {
       napi_throw_error(env, NULL, "Unable to napi_call_function");
     }
+    napi_delete_reference(env, item->cb_ref);
 
-    free(item);
+    // The C-SDK is done with the data, so the caller's Buffer(s) may now be collected
+    if (item->buf_ref != NULL) {
+      napi_delete_reference(env, item->buf_ref);
+    }
+    for (uint32_t i = 0; i < item->seg_count; i++) {
+      if (item->seg_refs[i] != NULL) {
+        napi_delete_reference(env, item->seg_refs[i]);
+      }
+    }
   }
+
+  if (item->chunk != NULL) {
+    free(item->chunk);
+  }
+  if (item->bufs != &item->buf) {
+    free(item->bufs);
+  }
+  free(item->seg_refs);
+  free(item);
 }
 
 
 /**
- * 
+ * Create the write-completion dispatcher for a connection. This is done once, when the
+ * connection's addon data is set up, rather than on every call to ziti_write.
  */
-static void on_write(ziti_connection conn, ssize_t status, void *ctx) {
+napi_status create_on_write_dispatcher(napi_env env, Dispatcher** result) {
+  // No JS function is bound here; CallJs_on_write takes it from each WriteItem.
+  return create_dispatcher(env, NULL, "N-API on_write", CallJs_on_write, result);
+}
 
-  ConnAddonData* addon_data = (ConnAddonData*) ziti_conn_data(conn);
 
-  ZITI_NODEJS_LOG(DEBUG, "on_write cb entered: addon_data: %p", addon_data);
+/**
+ * Create the dispatcher used when a write queued for the network thread finds its connection gone.
+ * It lives as long as the process, so it must not keep the loop alive.
+ */
+napi_status init_closed_write_dispatcher(napi_env env) {
+  napi_status status;
 
-  WriteItem* item = memset(malloc(sizeof(*item)), 0, sizeof(*item));
-  item->conn = conn;
-  item->status = status;
+  if (closed_write_dispatcher != NULL) {
+    return napi_ok;
+  }
+
+  status = create_on_write_dispatcher(env, &closed_write_dispatcher);
+  if (status != napi_ok) {
+    return status;
+  }
+
+  return napi_unref_threadsafe_function(env, closed_write_dispatcher->tsfn);
+}
+
+
+/**
+ * Account for one part of a write. Once every part is done, the write is complete and its
+ * callback is dispatched (which may free the item).
+ */
+static void finish_write_part(WriteItem* item, ssize_t status, Dispatcher* dispatcher) {
+
+  if (item->status >= 0) {
+    item->status = (status < 0) ? status : (item->status + status);
+  }
+
+  if (--item->pending > 0) {
+    return;
+  }
 
   // Initiate the call into the JavaScript callback. 
-  // The call into JavaScript will not have happened 
-  // when this function returns, but it will be queued.
-  napi_status nstatus = napi_call_threadsafe_function(
-      addon_data->tsfn_on_write,
-      item,
-      napi_tsfn_blocking);
+  // The call into JavaScript has either happened already
+  // when this function returns, or it has been queued.
+  napi_status nstatus = dispatch_to_js(dispatcher, item);
   if (nstatus != napi_ok) {
-    ZITI_NODEJS_LOG(ERROR, "Unable to napi_call_threadsafe_function");
+    ZITI_NODEJS_LOG(ERROR, "Unable to dispatch_to_js");
   }
 }
 
@@ -130,10 +218,277 @@ static void on_write(ziti_connection conn, ssize_t status, void *ctx) {
 /**
  * 
  */
+static void on_write(ziti_connection conn, ssize_t status, void *ctx) {
+
+  // The WriteItem was created by _ziti_write/_ziti_writev, and holds the pinned Buffer(s) (or our private copy)
+  WriteItem* item = (WriteItem*)ctx;
+
+  // Use the addon data captured at write time; the connection may already have been closed
+  ConnAddonData* addon_data = item->addon_data;
+
+  ZITI_NODEJS_LOG(DEBUG, "on_write cb entered: addon_data: %p, status: %zd", addon_data, status);
+
+  finish_write_part(item, status, addon_data->on_write);
+
+  addon_data->pending_writes--;
+  release_conn_addon_data(addon_data);
+}
+
+
+/**
+ * Hand each part of a write to the C-SDK
+ */
+static void send_write(WriteItem* item, ConnAddonData* addon_data) {
+
+  // The extra pending part keeps the item alive until every part has been submitted, in case
+  // the C-SDK completes one before ziti_write returns
+  item->addon_data = addon_data;
+  item->pending = item->nbufs + 1;
+  addon_data->pending_writes += item->nbufs;
+
+  // Now, call the C-SDK to actually write the data over to the service
+  ZITI_NODEJS_LOG(DEBUG, "call ziti_write, parts: %u", item->nbufs);
+  for (unsigned int i = 0; i < item->nbufs; i++) {
+    int rc = ziti_write(item->conn, (uint8_t*)item->bufs[i].base, item->bufs[i].len, on_write, item);
+    if (rc != ZITI_OK) {
+      // Refused outright, so on_write will never fire for this part
+      ZITI_NODEJS_LOG(DEBUG, "ziti_write refused part %u: %d", i, rc);
+      addon_data->pending_writes--;
+      finish_write_part(item, rc, addon_data->on_write);
+    }
+  }
+  ZITI_NODEJS_LOG(DEBUG, "back from ziti_write");
+
+  finish_write_part(item, 0, addon_data->on_write);
+}
+
+
+static size_t write_item_len(const WriteItem* item) {
+  size_t len = 0;
+  for (unsigned int i = 0; i < item->nbufs; i++) {
+    len += item->bufs[i].len;
+  }
+  return len;
+}
+
+
+/**
+ * Each write in a batch completes with its own length (or the error), and the batch is freed
+ */
+static void finish_corked_batch(CorkBatch* batch, ssize_t status) {
+  ConnAddonData* addon_data = batch->addon_data;
+
+  WriteItem* item = batch->items;
+  while (item != NULL) {
+    WriteItem* next = item->next;
+    item->pending = 1;
+    finish_write_part(item, (status < 0) ? status : (ssize_t)write_item_len(item), addon_data->on_write);
+    item = next;
+  }
+
+  free(batch->block);
+  free(batch);
+}
+
+
+/**
+ * Completion of a batch of coalesced writes
+ */
+static void on_corked_write(ziti_connection conn, ssize_t status, void *ctx) {
+  CorkBatch* batch = (CorkBatch*)ctx;
+  ConnAddonData* addon_data = batch->addon_data;
+
+  ZITI_NODEJS_LOG(DEBUG, "on_corked_write cb entered: addon_data: %p, status: %zd", addon_data, status);
+
+  finish_corked_batch(batch, status);
+
+  addon_data->pending_writes--;
+  release_conn_addon_data(addon_data);
+}
+
+
+/**
+ * Send every write held back by cork/coalescing. A lone write goes out as it is; several are
+ * gathered into one block so they cost a single ziti_write (and Ziti message).
+ */
+void flush_corked_writes(ConnAddonData* addon_data) {
+  WriteItem* items = addon_data->corked_head;
+
+  if (addon_data->coalesce_timer != NULL) {
+    uv_timer_stop(addon_data->coalesce_timer);
+  }
+
+  if (items == NULL) {
+    return;
+  }
+
+  size_t len = addon_data->corked_bytes;
+  addon_data->corked_head = addon_data->corked_tail = NULL;
+  addon_data->corked_bytes = 0;
+
+  if (items->next == NULL) {
+    send_write(items, addon_data);
+    return;
+  }
+
+  CorkBatch* batch = calloc(1, sizeof(*batch));
+  batch->addon_data = addon_data;
+  batch->items = items;
+  batch->block = malloc(len);
+
+  size_t offset = 0;
+  for (WriteItem* item = items; item != NULL; item = item->next) {
+    for (unsigned int i = 0; i < item->nbufs; i++) {
+      memcpy((char*)batch->block + offset, item->bufs[i].base, item->bufs[i].len);
+      offset += item->bufs[i].len;
+    }
+  }
+
+  ZITI_NODEJS_LOG(DEBUG, "coalesced writes into %zu bytes", len);
+
+  addon_data->pending_writes++;
+  int rc = ziti_write(items->conn, (uint8_t*)batch->block, len, on_corked_write, batch);
+  if (rc != ZITI_OK) {
+    // Refused outright, so on_corked_write will never fire for the batch
+    ZITI_NODEJS_LOG(DEBUG, "ziti_write refused coalesced writes: %d", rc);
+    addon_data->pending_writes--;
+    finish_corked_batch(batch, rc);
+  }
+}
+
+
+/**
+ * Complete every write still held back by cork/coalescing with ZITI_CONN_CLOSED; the connection is gone
+ */
+void fail_corked_writes(ConnAddonData* addon_data) {
+  WriteItem* item = addon_data->corked_head;
+
+  if (addon_data->coalesce_timer != NULL) {
+    uv_timer_stop(addon_data->coalesce_timer);
+  }
+
+  addon_data->corked_head = addon_data->corked_tail = NULL;
+  addon_data->corked_bytes = 0;
+
+  while (item != NULL) {
+    WriteItem* next = item->next;
+    item->pending = 1;
+    finish_write_part(item, ZITI_CONN_CLOSED, addon_data->on_write);
+    item = next;
+  }
+}
+
+
+static void on_coalesce_timer(uv_timer_t* handle) {
+  flush_corked_writes((ConnAddonData*)handle->data);
+}
+
+
+/**
+ * Hold a write back until the connection is uncorked, or the coalescing delay runs out
+ */
+static void hold_write(WriteItem* item, ConnAddonData* addon_data) {
+
+  item->addon_data = addon_data;
+  if (addon_data->corked_tail != NULL) {
+    addon_data->corked_tail->next = item;
+  } else {
+    addon_data->corked_head = item;
+  }
+  addon_data->corked_tail = item;
+  addon_data->corked_bytes += write_item_len(item);
+
+  // Explicit corking holds everything until ziti_uncork
+  if (addon_data->cork_count > 0) {
+    return;
+  }
+
+  if (addon_data->corked_bytes >= ZITI_NODEJS_COALESCE_FLUSH_BYTES) {
+    flush_corked_writes(addon_data);
+    return;
+  }
+
+  // The delay runs from the oldest held-back write
+  if (item != addon_data->corked_head) {
+    return;
+  }
+
+  if (addon_data->coalesce_timer == NULL) {
+    addon_data->coalesce_timer = calloc(1, sizeof(uv_timer_t));
+    uv_timer_init(get_ziti_loop(), addon_data->coalesce_timer);
+    addon_data->coalesce_timer->data = addon_data;
+  }
+
+  // uv timers have millisecond resolution; a sub-millisecond delay means 'on the next loop iteration'
+  uint64_t timeout_ms = (addon_data->coalesce_delay_us + 999) / 1000;
+  if (addon_data->coalesce_delay_us < 1000) {
+    timeout_ms = 0;
+  }
+  uv_timer_start(addon_data->coalesce_timer, on_coalesce_timer, timeout_ms, 0);
+}
+
+
+/**
+ * Hand a write to the C-SDK, or hold it back if the connection is corked or coalescing.
+ * Runs on the thread that owns the connection.
+ */
+static void submit_write(void* arg) {
+  WriteItem* item = (WriteItem*)arg;
+
+  ConnAddonData* addon_data = (ConnAddonData*) ziti_conn_data(item->conn);
+  if (addon_data == NULL) {
+    // Only reachable with the network thread: the connection closed while the write was queued
+    ZITI_NODEJS_LOG(DEBUG, "conn: %p closed before write could be submitted", item->conn);
+    item->pending = 1;
+    finish_write_part(item, ZITI_CONN_CLOSED, closed_write_dispatcher);
+    return;
+  }
+
+  if ((addon_data->cork_count > 0) || (addon_data->coalesce_delay_us > 0)) {
+    hold_write(item, addon_data);
+    return;
+  }
+
+  send_write(item, addon_data);
+}
+
+
+/**
+ * Parse the connection argument, throwing if it is already known to be closed
+ */
+static bool get_write_conn(napi_env env, napi_value js_value, ziti_connection* conn) {
+  int64_t js_conn;
+
+  if (napi_get_value_int64(env, js_value, &js_conn) != napi_ok) {
+    napi_throw_error(env, NULL, "Failed to get Conn");
+    return false;
+  }
+  *conn = (ziti_connection)js_conn;
+
+  // With the network thread, the connection is checked there instead (see submit_write)
+  if (!net_thread_enabled() && (ziti_conn_data(*conn) == NULL)) {
+    napi_throw_error(env, "EINVAL", "connection is closed");
+    return false;
+  }
+
+  return true;
+}
+
+
+/**
+ * Write data to a Ziti connection
+ *
+ * @param {number}  [0] conn
+ * @param {Buffer}  [1] data
+ * @param {func}    [2] JS on_write callback;  This is invoked from 'on_write' function above
+ * @param {boolean} [3] copy (optional);       If true, the data is copied into a zeroed native buffer.
+ *                                             Otherwise the Buffer is pinned (not copied) until on_write fires,
+ *                                             so the caller must not modify it until then.
+ */
 napi_value _ziti_write(napi_env env, const napi_callback_info info) {
   napi_status status;
-  size_t argc = 3;
-  napi_value args[3];
+  size_t argc = 4;
+  napi_value args[4];
   status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   if (status != napi_ok) {
     napi_throw_error(env, NULL, "Failed to parse arguments");
@@ -145,14 +500,10 @@ napi_value _ziti_write(napi_env env, const napi_callback_info info) {
   }
 
   // Obtain ziti_connection
-  int64_t js_conn;
-  status = napi_get_value_int64(env, args[0], &js_conn);
-  if (status != napi_ok) {
-    napi_throw_error(env, NULL, "Failed to get Conn");
+  ziti_connection conn;
+  if (!get_write_conn(env, args[0], &conn)) {
+    return NULL;
   }
-  ziti_connection conn = (ziti_connection)js_conn;
-
-  ConnAddonData* addon_data = (ConnAddonData*) ziti_conn_data(conn);
 
   // Obtain data to write (we expect a Buffer)
   void*  buffer;
@@ -160,56 +511,379 @@ napi_value _ziti_write(napi_env env, const napi_callback_info info) {
   status = napi_get_buffer_info(env, args[1], &buffer, &bufferLength);
   if (status != napi_ok) {
     napi_throw_error(env, NULL, "Failed to get Buffer info");
+    return NULL;
   }
 
-  // Since the underlying Buffer's lifetime is not guaranteed if it's managed by the VM, we will copy the chunk into our heap
-  void* chunk = memset(malloc(bufferLength), 0, bufferLength);
-  memcpy(chunk, buffer, bufferLength);
+  // Obtain (optional) copy flag
+  bool copy = false;
+  if (argc > 3) {
+    napi_valuetype valuetype;
+    status = napi_typeof(env, args[3], &valuetype);
+    if ((status == napi_ok) && (valuetype == napi_boolean)) {
+      status = napi_get_value_bool(env, args[3], &copy);
+      if (status != napi_ok) {
+        napi_throw_error(env, NULL, "Failed to get copy flag");
+      }
+    }
+  }
 
-  // Obtain ptr to JS 'write' callback function
+  WriteItem* item = calloc(1, sizeof(*item));
+  item->conn = conn;
+
+  if (copy) {
+    // Caller asked that we not hold on to its Buffer, so copy the chunk into our heap
+    item->chunk = memset(malloc(bufferLength), 0, bufferLength);
+    memcpy(item->chunk, buffer, bufferLength);
+    buffer = item->chunk;
+  } else {
+    // Pin the Buffer so the VM can't collect it while the C-SDK still references its contents
+    status = napi_create_reference(env, args[1], 1, &item->buf_ref);
+    if (status != napi_ok) {
+      free(item);
+      napi_throw_error(env, NULL, "Failed to napi_create_reference");
+      return NULL;
+    }
+  }
+
+  // Obtain ptr to JS 'write' callback function, and hold on to it until on_write fires
   napi_value js_write_cb = args[2];
   ZITI_NODEJS_LOG(DEBUG, "js_write_cb: %p", js_write_cb);
 
-  napi_value work_name;
+  status = napi_create_reference(env, js_write_cb, 1, &item->cb_ref);
+  if (status != napi_ok) {
+    if (item->buf_ref != NULL) {
+      napi_delete_reference(env, item->buf_ref);
+    }
+    free(item->chunk);
+    free(item);
+    napi_throw_error(env, NULL, "Failed to napi_create_reference");
+    return NULL;
+  }
+
+  item->buf = uv_buf_init(buffer, bufferLength);
+  item->bufs = &item->buf;
+  item->nbufs = 1;
+
+  enter_native_call();
+  run_on_ziti_thread(submit_write, item);
+  leave_native_call();
+
+  return NULL;
+}
 
-  // Create a string to describe this asynchronous operation.
-  status = napi_create_string_utf8(
-    env,
-    "N-API on_write",
-    NAPI_AUTO_LENGTH,
-    &work_name);
+
+
+static bool is_small_segment(const uv_buf_t* seg) {
+  return (seg->len > 0) && (seg->len < ZITI_NODEJS_WRITEV_GATHER_THRESHOLD);
+}
+
+
+/**
+ * Drop a writev item that was never submitted, unpinning whatever segments it had pinned
+ */
+static void discard_writev_item(napi_env env, WriteItem* item) {
+  for (uint32_t i = 0; i < item->seg_count; i++) {
+    if (item->seg_refs[i] != NULL) {
+      napi_delete_reference(env, item->seg_refs[i]);
+    }
+  }
+  free(item->chunk);
+  free(item->bufs);
+  free(item->seg_refs);
+  free(item);
+}
+
+
+/**
+ * Write several Buffers to a Ziti connection as one logical write, with a single completion
+ *
+ * Small segments are gathered (copied) into a block, together with whatever segments follow them
+ * while the block stays within ZITI_NODEJS_WRITEV_GATHER_MAX, so that e.g. [header, body] goes out as
+ * one Ziti message rather than two. Other segments are pinned and sent in place.
+ *
+ * @param {number}   [0] conn
+ * @param {Buffer[]} [1] segments
+ * @param {func}     [2] JS on_write callback;  Invoked once, when every segment has been written.
+ *                                              Its status is the total bytes written, or the first error.
+ */
+napi_value _ziti_writev(napi_env env, const napi_callback_info info) {
+  napi_status status;
+  size_t argc = 3;
+  napi_value args[3];
+  status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   if (status != napi_ok) {
-    napi_throw_error(env, NULL, "Failed to napi_create_string_utf8");
-  }
-
-  // Convert the callback retrieved from JavaScript into a thread-safe function (tsfn) 
-  // which we can call from a worker thread.
-  status = napi_create_threadsafe_function(
-      env,
-      js_write_cb,
-      NULL,
-      work_name,
-      0,
-      1,
-      NULL,
-      NULL,
-      NULL,
-      CallJs_on_write,
-      &(addon_data->tsfn_on_write));
+    napi_throw_error(env, NULL, "Failed to parse arguments");
+  }
+
+  if (argc < 3) {
+    napi_throw_error(env, "EINVAL", "Too few arguments");
+    return NULL;
+  }
+
+  // Obtain ziti_connection
+  ziti_connection conn;
+  if (!get_write_conn(env, args[0], &conn)) {
+    return NULL;
+  }
+
+  // Obtain the segments (we expect an Array of Buffers)
+  bool is_array = false;
+  uint32_t count = 0;
+  if ((napi_is_array(env, args[1], &is_array) != napi_ok) || !is_array ||
+      (napi_get_array_length(env, args[1], &count) != napi_ok)) {
+    napi_throw_error(env, "EINVAL", "segments must be an Array of Buffers");
+    return NULL;
+  }
+
+  napi_value* segs = calloc(count + 1, sizeof(napi_value));
+  uv_buf_t* seg_bufs = calloc(count + 1, sizeof(uv_buf_t));
+  size_t gathered_len = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    void* data;
+    size_t len;
+    if ((napi_get_element(env, args[1], i, &segs[i]) != napi_ok) ||
+        (napi_get_buffer_info(env, segs[i], &data, &len) != napi_ok)) {
+      free(segs);
+      free(seg_bufs);
+      napi_throw_error(env, "EINVAL", "segments must be an Array of Buffers");
+      return NULL;
+    }
+    seg_bufs[i] = uv_buf_init(data, len);
+  }
+
+  // Decide where each segment goes: a small one starts a block (unless it fits in the current one),
+  // and any segment joins the current block if the block stays within the cap
+  enum { SEND_IN_PLACE, START_BLOCK, JOIN_BLOCK };
+  uint8_t* gather = calloc(count + 1, sizeof(uint8_t));
+  size_t block_len = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    size_t len = seg_bufs[i].len;
+    if (len == 0) {
+      continue;
+    }
+    if ((block_len > 0) && (block_len + len <= ZITI_NODEJS_WRITEV_GATHER_MAX)) {
+      gather[i] = JOIN_BLOCK;
+      block_len += len;
+    } else if (is_small_segment(&seg_bufs[i])) {
+      gather[i] = START_BLOCK;
+      block_len = len;
+    } else {
+      block_len = 0;
+    }
+    if (gather[i] != SEND_IN_PLACE) {
+      gathered_len += len;
+    }
+  }
+
+  WriteItem* item = calloc(1, sizeof(*item));
+  item->conn = conn;
+  item->seg_refs = calloc(count + 1, sizeof(napi_ref));
+  item->seg_count = count;
+  item->bufs = calloc(count + 1, sizeof(uv_buf_t));
+  item->chunk = (gathered_len > 0) ? malloc(gathered_len) : NULL;
+
+  size_t offset = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    if (seg_bufs[i].len == 0) {
+      continue;
+    }
+
+    if (gather[i] != SEND_IN_PLACE) {
+      // Start a new block, or append to the one being gathered
+      if (gather[i] == START_BLOCK) {
+        item->bufs[item->nbufs++] = uv_buf_init((char*)item->chunk + offset, 0);
+      }
+      memcpy((char*)item->chunk + offset, seg_bufs[i].base, seg_bufs[i].len);
+      offset += seg_bufs[i].len;
+      item->bufs[item->nbufs - 1].len += seg_bufs[i].len;
+      continue;
+    }
+
+    // Pin the Buffer so the VM can't collect it while the C-SDK still references its contents
+    status = napi_create_reference(env, segs[i], 1, &item->seg_refs[i]);
+    if (status != napi_ok) {
+      discard_writev_item(env, item);
+      free(segs);
+      free(seg_bufs);
+      free(gather);
+      napi_throw_error(env, NULL, "Failed to napi_create_reference");
+      return NULL;
+    }
+    item->bufs[item->nbufs++] = seg_bufs[i];
+  }
+
+  free(segs);
+  free(seg_bufs);
+  free(gather);
+
+  // Obtain ptr to JS 'write' callback function, and hold on to it until the last on_write fires
+  status = napi_create_reference(env, args[2], 1, &item->cb_ref);
   if (status != napi_ok) {
-    napi_throw_error(env, NULL, "Failed to napi_create_threadsafe_function");
+    discard_writev_item(env, item);
+    napi_throw_error(env, NULL, "Failed to napi_create_reference");
+    return NULL;
   }
 
-  // Now, call the C-SDK to actually write the data over to the service
-  ZITI_NODEJS_LOG(DEBUG, "call ziti_write");
-  ziti_write(conn, chunk, bufferLength, on_write, NULL);
-  ZITI_NODEJS_LOG(DEBUG, "back from ziti_write");
+  ZITI_NODEJS_LOG(DEBUG, "segments: %u, parts: %u, gathered: %zu bytes", count, item->nbufs, gathered_len);
+
+  enter_native_call();
+  run_on_ziti_thread(submit_write, item);
+  leave_native_call();
 
   return NULL;
 }
 
 
 
+// What a queued cork command does to its connection
+typedef enum {
+  CORK_CORK,
+  CORK_UNCORK,
+  CORK_SET_COALESCE_DELAY
+} CorkOp;
+
+// A cork change on its way to the thread that owns the connection
+typedef struct CorkItem {
+  ziti_connection conn;
+  CorkOp op;
+  uint64_t value;
+} CorkItem;
+
+
+static void apply_cork_op(ConnAddonData* addon_data, CorkOp op, uint64_t value) {
+  switch (op) {
+    case CORK_CORK:
+      addon_data->cork_count++;
+      ZITI_NODEJS_LOG(DEBUG, "addon_data: %p, cork_count: %d", addon_data, addon_data->cork_count);
+      break;
+    case CORK_UNCORK:
+      if (addon_data->cork_count > 0) {
+        addon_data->cork_count--;
+      }
+      ZITI_NODEJS_LOG(DEBUG, "addon_data: %p, cork_count: %d", addon_data, addon_data->cork_count);
+      if (addon_data->cork_count == 0) {
+        flush_corked_writes(addon_data);
+      }
+      break;
+    case CORK_SET_COALESCE_DELAY:
+      ZITI_NODEJS_LOG(DEBUG, "addon_data: %p, coalesce_delay_us: %" PRIu64, addon_data, value);
+      addon_data->coalesce_delay_us = value;
+      // Writes held back under the old delay are sent now rather than re-timed
+      if ((value == 0) && (addon_data->cork_count == 0)) {
+        flush_corked_writes(addon_data);
+      }
+      break;
+  }
+}
+
+
+/**
+ * Runs on the network thread: the connection may have closed since JS asked, in which case there is nothing to do
+ */
+static void cork_op_command(void* arg) {
+  CorkItem* item = (CorkItem*)arg;
+
+  ConnAddonData* addon_data = (ConnAddonData*) ziti_conn_data(item->conn);
+  if (addon_data != NULL) {
+    apply_cork_op(addon_data, item->op, item->value);
+  }
+
+  free(item);
+}
+
+
+/**
+ * Apply a cork change requested by JS to the connection in args[0]
+ */
+static napi_value cork_op(napi_env env, size_t argc, napi_value* args, CorkOp op, uint64_t value) {
+
+  if (argc < 1) {
+    napi_throw_error(env, "EINVAL", "Too few arguments");
+    return NULL;
+  }
+
+  // Obtain ziti_connection
+  ziti_connection conn;
+  if (!get_write_conn(env, args[0], &conn)) {
+    return NULL;
+  }
+
+  CorkItem* item = calloc(1, sizeof(*item));
+  item->conn = conn;
+  item->op = op;
+  item->value = value;
+
+  enter_native_call();
+  run_on_ziti_thread(cork_op_command, item);
+  leave_native_call();
+
+  NAPI_UNDEFINED(env, undefined);
+  return undefined;
+}
+
+
+/**
+ * Hold back writes on a connection until a matching ziti_uncork, so that they go out together.
+ * Calls nest; each ziti_cork needs its own ziti_uncork.
+ *
+ * @param {number} [0] conn
+ */
+static napi_value _ziti_cork(napi_env env, const napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+
+  NAPI_CHECK(env, "parse arguments", napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+  return cork_op(env, argc, args, CORK_CORK, 0);
+}
+
+
+/**
+ * Undo one ziti_cork. When none remain, the held-back writes are sent as a single ziti_write;
+ * each still gets its own on_write callback.
+ *
+ * @param {number} [0] conn
+ */
+static napi_value _ziti_uncork(napi_env env, const napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+
+  NAPI_CHECK(env, "parse arguments", napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+  return cork_op(env, argc, args, CORK_UNCORK, 0);
+}
+
+
+/**
+ * Set how long writes on a connection may be held back so that small ones coalesce (Nagle-style).
+ * Held-back writes are sent when the delay runs out, or early once 64KiB are waiting.
+ *
+ * @param {number} [0] conn
+ * @param {number} [1] delay (microseconds); 0 turns coalescing off
+ */
+static napi_value _ziti_set_coalesce_delay(napi_env env, const napi_callback_info info) {
+  size_t argc = 2;
+  napi_value args[2];
+
+  NAPI_CHECK(env, "parse arguments", napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+  if (argc < 2) {
+    napi_throw_error(env, "EINVAL", "Too few arguments");
+    return NULL;
+  }
+
+  int64_t delay_us;
+  if ((napi_get_value_int64(env, args[1], &delay_us) != napi_ok) || (delay_us < 0)) {
+    napi_throw_error(env, "EINVAL", "delay must be a non-negative number of microseconds");
+    return NULL;
+  }
+
+  return cork_op(env, argc, args, CORK_SET_COALESCE_DELAY, (uint64_t)delay_us);
+}
+
+
+
 /**
  * 
  */
@@ -229,3 +903,7 @@ void expose_ziti_write(napi_env env, napi_value exports) {
 
 }
 
+ZNODE_EXPOSE(ziti_writev, _ziti_writev)
+ZNODE_EXPOSE(ziti_cork, _ziti_cork)
+ZNODE_EXPOSE(ziti_uncork, _ziti_uncork)
+ZNODE_EXPOSE(ziti_set_coalesce_delay, _ziti_set_coalesce_delay)
@@ -9,6 +9,22 @@ suite("Ziti SDK Addon Tests", () => {
         assert(typeof ziti.enroll === "function", "ziti_enroll should be a function");
         assert(typeof ziti.setLogger === "function", "ziti_set_logger should be a function");
         assert(typeof ziti.extAuthToken === "function", "ziti_ext_auth_token should be a function");
+        assert(typeof ziti.ziti_writev === "function", "ziti_writev should be a function");
+        assert(typeof ziti.ziti_cork === "function", "ziti_cork should be a function");
+        assert(typeof ziti.ziti_uncork === "function", "ziti_uncork should be a function");
+        assert(typeof ziti.ziti_set_coalesce_delay === "function", "ziti_set_coalesce_delay should be a function");
+        assert(typeof ziti.ziti_set_https_pool_config === "function", "ziti_set_https_pool_config should be a function");
+        assert(typeof ziti.ziti_https_pool_stats === "function", "ziti_https_pool_stats should be a function");
+        assert(typeof ziti.Ziti_http_request_cancel === "function", "Ziti_http_request_cancel should be a function");
+        assert(typeof ziti.onServiceEvent === "function", "onServiceEvent should be a function");
+        assert(typeof ziti.ziti_set_service_event_callback === "function", "ziti_set_service_event_callback should be a function");
+        assert(typeof ziti.serviceAvailableSync === "function", "serviceAvailableSync should be a function");
+        assert(typeof ziti.servicesAvailableSync === "function", "servicesAvailableSync should be a function");
+        assert(typeof ziti.servicesProvisional === "function", "servicesProvisional should be a function");
+        assert(typeof ziti.ziti_pause === "function", "ziti_pause should be a function");
+        assert(typeof ziti.ziti_resume === "function", "ziti_resume should be a function");
+        assert(typeof ziti.ziti_set_high_water_mark === "function", "ziti_set_high_water_mark should be a function");
+        assert(typeof ziti.ziti_close_write === "function", "ziti_close_write should be a function");
 
     })
     test("ziti_sdk_version test", () => {
@@ -0,0 +1,30 @@
+const assert = require("node:assert");
+const test = require("node:test");
+const suite = test.suite;
+require("./native-stub");
+
+const { getFallbackDialInfo } = require("../lib/connect");
+
+suite("connect fallback dial info", () => {
+    test("is built once per host:port and carries the destination", () => {
+        const dialInfo = getFallbackDialInfo("example.com", 443);
+        assert.strictEqual(getFallbackDialInfo("example.com", 443), dialInfo);
+        assert.strictEqual(dialInfo.service, "example.com");
+        assert.deepStrictEqual(JSON.parse(dialInfo.dial_data),
+            { dst_protocol: "tcp", dst_hostname: "example.com", dst_port: "443" });
+    });
+
+    test("evicts the oldest entry once full", () => {
+        // 1024 entries of its own push out whatever earlier tests left
+        const first = getFallbackDialInfo("evict-0", 80);
+        const second = getFallbackDialInfo("evict-1", 80);
+        for (let i = 2; i < 1024; i++) {
+            getFallbackDialInfo(`evict-${i}`, 80);
+        }
+        assert.strictEqual(getFallbackDialInfo("evict-0", 80), first);
+
+        getFallbackDialInfo("evict-1024", 80);
+        assert.strictEqual(getFallbackDialInfo("evict-1", 80), second);
+        assert.notStrictEqual(getFallbackDialInfo("evict-0", 80), first);
+    });
+});
@@ -0,0 +1,25 @@
+const assert = require("node:assert");
+const test = require("node:test");
+const suite = test.suite;
+const { natives } = require("./native-stub");
+
+const { buildHeaders, httpRequest } = require("../lib/httpRequest");
+
+suite("httpRequest headers", () => {
+    test("buildHeaders keeps the last value per name and collects set-cookie", () => {
+        const headers = buildHeaders(["A", "1", "Set-Cookie", "x=1", "A", "2", "set-cookie", "y=2"]);
+        assert.deepStrictEqual(headers, { A: "2", "Set-Cookie": ["x=1", "y=2"] });
+    });
+
+    test("the response's headers are built from rawHeaders on first access", async () => {
+        let onResp;
+        natives.Ziti_http_request = (...args) => { onResp = args[6]; return {}; };
+        let resp;
+        await httpRequest("svc", "https://h", "GET", "/", [], undefined, (obj) => { resp = obj; }, undefined);
+
+        onResp({ code: 200, rawHeaders: ["Content-Type", "text/plain"] });
+        assert.deepStrictEqual(resp.rawHeaders, ["Content-Type", "text/plain"]);
+        assert.deepStrictEqual(resp.headers, { "Content-Type": "text/plain" });
+        assert.strictEqual(resp.headers, resp.headers, "headers rebuilt on each access");
+    });
+});
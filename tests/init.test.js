@@ -0,0 +1,36 @@
+const assert = require("node:assert");
+const test = require("node:test");
+const suite = test.suite;
+const { natives } = require("./native-stub");
+
+const { init } = require("../lib/init");
+
+suite("init options", () => {
+    test("passes networkThread through to native", async () => {
+        let args;
+        natives.ziti_init = (...a) => { args = a; a[1](0); };
+        const onAuth = () => {};
+        await init("identity.json", onAuth, { networkThread: true });
+        assert.strictEqual(args[2], onAuth);
+        assert.strictEqual(args[3], true);
+
+        await init("identity.json");
+        assert.strictEqual(args[2], undefined);
+        assert.strictEqual(args[3], false);
+    });
+
+    test("passes serviceCache through to native", async () => {
+        let args;
+        natives.ziti_init = (...a) => { args = a; a[1](0); };
+        await init("identity.json", undefined, { serviceCache: "/tmp/services.cache" });
+        assert.strictEqual(args[4], "/tmp/services.cache");
+
+        await init("identity.json");
+        assert.strictEqual(args[4], undefined);
+    });
+
+    test("rejects with the error native reports", async () => {
+        natives.ziti_init = (path, cb) => cb(new Error("CONTROLLER_UNAVAILABLE"));
+        await assert.rejects(init("identity.json"), { message: "CONTROLLER_UNAVAILABLE" });
+    });
+});
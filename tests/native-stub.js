@@ -0,0 +1,25 @@
+// The lib/ wrappers call the native addon through the global 'ziti'. Tests require this first to stand in
+// for it: every native not given an implementation in 'natives' records its calls in 'calls'.
+const test = require("node:test");
+
+const calls = [];
+const natives = {};
+globalThis.ziti = new Proxy(natives, {
+    get(target, name) {
+        if (name in target) {
+            return target[name];
+        }
+        return (...args) => { calls.push({ name, args }); };
+    },
+});
+
+const callsTo = (name) => calls.filter((c) => c.name === name);
+
+test.beforeEach(() => {
+    calls.length = 0;
+    for (const name of Object.keys(natives)) {
+        delete natives[name];
+    }
+});
+
+module.exports = { natives, callsTo };
@@ -0,0 +1,47 @@
+const assert = require("node:assert");
+const test = require("node:test");
+const suite = test.suite;
+const { natives } = require("./native-stub");
+
+const { onServiceEvent } = require("../lib/onServiceEvent");
+
+suite("onServiceEvent", () => {
+    test("delivers the current services to the first listener before returning", () => {
+        const registered = [];
+        natives.ziti_set_service_event_callback = (cb) => {
+            registered.push(cb);
+            // as native does: the current services, before ziti_set_service_event_callback returns
+            if (cb !== undefined) {
+                cb({ added: [{ name: "a", configs: { "intercept.v1": "{\"protocols\":[\"tcp\"]}" } }], changed: [], removed: [] });
+            }
+        };
+
+        const first = [];
+        const stopFirst = onServiceEvent((event) => first.push(event));
+        assert.strictEqual(registered.length, 1);
+        assert.strictEqual(first.length, 1);
+        assert.deepStrictEqual(first[0].added[0].configs["intercept.v1"], { protocols: ["tcp"] });
+
+        const second = [];
+        const stopSecond = onServiceEvent((event) => second.push(event));
+        assert.strictEqual(registered.length, 1, "native callback set again for a second listener");
+        assert.deepStrictEqual(second.map((e) => e.added.map((s) => s.name)), [["a"]]);
+
+        registered[0]({ added: [], changed: [], removed: [{ name: "a", configs: {} }] });
+        assert.strictEqual(first.length, 2);
+        assert.strictEqual(second.length, 2);
+
+        stopFirst();
+        assert.strictEqual(registered.length, 1);
+        stopSecond();
+        assert.deepStrictEqual(registered.slice(1), [undefined]);
+
+        // an event that was already on its way reaches nobody
+        registered[0]({ added: [{ name: "b", configs: {} }], changed: [], removed: [] });
+        assert.strictEqual(first.length, 2);
+    });
+
+    test("rejects a listener that is not a function", () => {
+        assert.throws(() => onServiceEvent("nope"), TypeError);
+    });
+});
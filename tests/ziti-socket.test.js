@@ -0,0 +1,65 @@
+const assert = require("node:assert");
+const test = require("node:test");
+const suite = test.suite;
+const { natives, callsTo } = require("./native-stub");
+
+const { ZitiSocket } = require("../lib/ziti-socket");
+
+suite("ZitiSocket", () => {
+    test("applies only a positive, caller-set high water mark natively", () => {
+        new ZitiSocket({ client: 1 });
+        new ZitiSocket({ client: 2, readableHighWaterMark: 0 });
+        new ZitiSocket({ client: 3, readableHighWaterMark: 4096 });
+        assert.deepStrictEqual(callsTo("ziti_set_high_water_mark").map((c) => c.args), [[3, 4096]]);
+    });
+
+    test("end() half-closes once queued writes complete", async () => {
+        const writes = [];
+        natives.ziti_write = (conn, buf, cb) => { writes.push({ buf, cb }); };
+        const socket = new ZitiSocket({ client: 7, allowHalfOpen: true });
+        const finished = new Promise((resolve) => socket.on("finish", resolve));
+
+        socket.end("hello");
+        await new Promise(setImmediate);
+        assert.strictEqual(writes.length, 1);
+        assert.strictEqual(callsTo("ziti_close_write").length, 0, "half-closed before the write completed");
+
+        writes[0].cb({ status: 0 });
+        await finished;
+        assert.deepStrictEqual(callsTo("ziti_close_write").map((c) => c.args), [[7]]);
+        assert.strictEqual(callsTo("ziti_close").length, 0);
+    });
+
+    test("pauses the connection when the readable buffer fills, and resumes on read", async () => {
+        const socket = new ZitiSocket({ client: 9, readableHighWaterMark: 8 });
+
+        socket.captureData(Buffer.alloc(16));
+        assert.strictEqual(callsTo("ziti_pause").length, 1);
+        socket.captureData(Buffer.alloc(16));
+        assert.strictEqual(callsTo("ziti_pause").length, 1, "paused twice");
+
+        socket.read();
+        await new Promise(setImmediate);
+        assert.deepStrictEqual(callsTo("ziti_resume").map((c) => c.args), [[9]]);
+    });
+
+    test("fails a write the connection reports failed", async () => {
+        natives.ziti_write = (conn, buf, cb) => cb({ status: -22 });
+        const socket = new ZitiSocket({ client: 5 });
+        const err = await new Promise((resolve) => socket.on("error", resolve).write("x"));
+        assert.strictEqual(err.code, "EZITIWRITE");
+        assert.strictEqual(err.status, -22);
+    });
+
+    test("destroy() closes the connection once, unless native already has", () => {
+        const socket = new ZitiSocket({ client: 11 });
+        socket.destroy();
+        socket.destroy();
+        assert.deepStrictEqual(callsTo("ziti_close").map((c) => c.args), [[11]]);
+
+        const closed = new ZitiSocket({ client: 12 });
+        closed.captureData(undefined, true);
+        assert(closed.destroyed);
+        assert.strictEqual(callsTo("ziti_close").length, 1);
+    });
+});